@@ -807,6 +807,12 @@ CmdLineParser::Result CmdLineParser::parseFromArgs(int argc, const char* const a
         else if (std::strcmp(argv[i], "--funsigned-char") == 0)
             defaultSign = 'u';
 
+        // Share the tokens of headers between files
+        else if (std::strncmp(argv[i], "--header-cache=", 15) == 0) {
+            if (!parseNumberArg(argv[i], 15, mSettings.headerCacheSize, true))
+                return Result::Fail;
+        }
+
         // Ignored paths
         else if (std::strncmp(argv[i], "-i", 2) == 0) {
             std::string path;
@@ -1810,6 +1816,10 @@ void CmdLineParser::printHelp() const
         "    --fsigned-char       Treat char type as signed.\n"
         "    --funsigned-char     Treat char type as unsigned.\n"
         "    -h, --help           Print this help.\n"
+        "    --header-cache=<MiB>\n"
+        "                         Keep the tokens of header files in memory and share\n"
+        "                         them between all checked files. <MiB> is the memory\n"
+        "                         limit of the cache, the default 0 disables it.\n"
         "    -I <dir>             Give path to search for include files. Give several -I\n"
         "                         parameters to give several paths. First given path is\n"
         "                         searched for contained header files first. If paths are\n"
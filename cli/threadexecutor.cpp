@@ -29,7 +29,10 @@
 #include "timer.h"
 
 #include <cassert>
+#include <condition_variable>
 #include <cstdlib>
+#include <deque>
+#include <functional>
 #include <future>
 #include <iostream>
 #include <list>
@@ -121,6 +124,9 @@ public:
 
     unsigned int check(const FileWithDetails *file, const FileSettings *fs) {
         CppCheck fileChecker(mSettings, mSuppressions, mLogForwarder, mTimerResults, false, mExecuteCommand);
+        fileChecker.setScheduleTask([this](std::function<void()> task) {
+            return schedule(std::move(task));
+        });
 
         unsigned int result;
         if (fs) {
@@ -158,6 +164,40 @@ public:
             mLogForwarder.reportStatus(mProcessedFiles, mTotalFiles, mProcessedSize, mTotalFileSize);
     }
 
+    /**
+     * Hand over a task to a thread which has run out of files.
+     * @return false if there is no such thread
+     */
+    bool schedule(std::function<void()> task) {
+        std::lock_guard<std::mutex> l(mTaskSync);
+        if (mTasks.size() >= mIdleThreads)
+            return false;
+        mTasks.push_back(std::move(task));
+        mTaskCond.notify_one();
+        return true;
+    }
+
+    /** Execute the tasks of the other threads until all of them have run out of files */
+    void runTasks() {
+        std::unique_lock<std::mutex> l(mTaskSync);
+        ++mFinishedThreads;
+        for (;;) {
+            ++mIdleThreads;
+            mTaskCond.wait(l, [this] {
+                return !mTasks.empty() || mFinishedThreads == mSettings.jobs;
+            });
+            --mIdleThreads;
+            if (mTasks.empty())
+                break;
+            std::function<void()> task = std::move(mTasks.front());
+            mTasks.pop_front();
+            l.unlock();
+            task();
+            l.lock();
+        }
+        mTaskCond.notify_all();
+    }
+
 private:
     const std::list<FileWithDetails> &mFiles;
     std::list<FileWithDetails>::const_iterator mItNextFile;
@@ -170,6 +210,12 @@ private:
     std::size_t mTotalFileSize{};
 
     std::mutex mFileSync;
+
+    std::mutex mTaskSync;
+    std::condition_variable mTaskCond;
+    std::deque<std::function<void()>> mTasks;
+    unsigned int mIdleThreads{};
+    unsigned int mFinishedThreads{};
     TimerResults *mTimerResults;
     const Settings &mSettings;
     Suppressions &mSuppressions;
@@ -192,6 +238,9 @@ static unsigned int STDCALL threadProc(ThreadData *data)
         data->status(fileSize);
     }
 
+    // help out the threads which are still checking a file
+    data->runTasks();
+
     return result;
 }
 
@@ -36,24 +36,27 @@
 #include <fstream>
 #include <iostream>
 #include <istream>
+#include <iterator>
 #include <limits>
 #include <list>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <sstream>
 #include <stack>
 #include <stdexcept>
 #include <string>
-#ifdef SIMPLECPP_WINDOWS
-#  include <mutex>
-#endif
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #ifdef _WIN32
 #  include <direct.h>
 #else
+#  include <cerrno>
+#  include <dirent.h>
 #  include <sys/stat.h>
 #endif
 
@@ -303,7 +306,27 @@ public:
             unget();
     }
 
+    /**
+     * Get the unread characters if they can be scanned in bulk by the
+     * lexer, that is if the stream is a buffer of single byte characters.
+     * @param size the count of unread characters
+     * @return the unread characters or nullptr
+     */
+    const unsigned char *unread(std::size_t &size) {
+        return isUtf16 ? nullptr : buffer(size);
+    }
+
+    /** Skip characters that have been scanned with unread() */
+    virtual void skip(std::size_t count) {
+        (void)count;
+    }
+
 protected:
+    virtual const unsigned char *buffer(std::size_t &size) {
+        (void)size;
+        return nullptr;
+    }
+
     void init() {
         // initialize since we use peek() in getAndSkipBOM()
         isUtf16 = false;
@@ -403,6 +426,17 @@ public:
     bool good() override {
         return lastStatus != EOF;
     }
+    void skip(std::size_t count) override {
+        pos += count;
+    }
+
+protected:
+    const unsigned char *buffer(std::size_t &n) override {
+        if (pos >= size)
+            return nullptr;
+        n = size - pos;
+        return str + pos;
+    }
 
 private:
     const unsigned char *str;
@@ -411,60 +445,38 @@ private:
     int lastStatus{};
 };
 
-class FileStream : public simplecpp::TokenList::Stream {
+/** The contents of a file, it is read as a whole so it can be scanned in bulk */
+class FileContents {
 public:
     /**
      * @throws simplecpp::Output thrown if file is not found
      */
-    // cppcheck-suppress uninitDerivedMemberVar - we call Stream::init() to initialize the private members
-    explicit FileStream(const std::string &filename, std::vector<std::string> &files)
-        : file(fopen(filename.c_str(), "rb"))
-    {
+    FileContents(const std::string &filename, std::vector<std::string> &files) {
+        FILE * const file = fopen(filename.c_str(), "rb");
         if (!file) {
             files.push_back(filename);
             throw simplecpp::Output(simplecpp::Output::FILE_NOT_FOUND, {}, "File is missing: " + filename);
         }
-        init();
-    }
-
-    FileStream(const FileStream&) = delete;
-    FileStream &operator=(const FileStream&) = delete;
-
-    ~FileStream() override {
+        unsigned char buf[4096];
+        std::size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), file)) > 0)
+            contents.insert(contents.end(), buf, buf + n);
         fclose(file);
-        file = nullptr;
-    }
-
-    int get() override {
-        lastStatus = lastCh = fgetc(file);
-        return lastCh;
-    }
-    int peek() override {
-        // keep lastCh intact
-        const int ch = fgetc(file);
-        unget_internal(ch);
-        return ch;
-    }
-    void unget() override {
-        unget_internal(lastCh);
-    }
-    bool good() override {
-        return lastStatus != EOF;
     }
 
-private:
-    void unget_internal(int ch) {
-        if (isUtf16) {
-            // TODO: use ungetc() as well
-            // UTF-16 has subsequent unget() calls
-            fseek(file, -1, SEEK_CUR);
-        } else
-            ungetc(ch, file);
-    }
+protected:
+    std::vector<unsigned char> contents;
+};
 
-    FILE *file;
-    int lastCh{};
-    int lastStatus{};
+class FileStream : private FileContents, public StdCharBufStream {
+public:
+    /**
+     * @throws simplecpp::Output thrown if file is not found
+     */
+    explicit FileStream(const std::string &filename, std::vector<std::string> &files)
+        : FileContents(filename, files)
+        , StdCharBufStream(contents.data(), contents.size())
+    {}
 };
 
 simplecpp::TokenList::TokenList(std::vector<std::string> &filenames) : frontToken(nullptr), backToken(nullptr), files(filenames) {}
@@ -601,6 +613,40 @@ static bool isNameChar(unsigned char ch)
     return std::isalnum(ch) || ch == '_' || ch == '$';
 }
 
+/** Count the leading blanks, i.e. whitespace except line breaks */
+static std::size_t countBlanks(const unsigned char *data, std::size_t size)
+{
+    std::size_t n = 0;
+    while (n < size && data[n] <= ' ' && data[n] != '\n' && data[n] != '\r')
+        ++n;
+    return n;
+}
+
+static std::size_t countNameChars(const unsigned char *data, std::size_t size)
+{
+    std::size_t n = 0;
+    while (n < size && isNameChar(data[n]))
+        ++n;
+    return n;
+}
+
+/**
+ * Find the first of the characters. memchr() is vectorized in the C
+ * libraries, and each search is limited to the part before the previous
+ * hit, so the first character should be the one that is found first
+ * usually.
+ * @return the position or size if none of the characters is found
+ */
+static std::size_t findFirstOf(const unsigned char *data, std::size_t size, const char *chars)
+{
+    for (; *chars; ++chars) {
+        const void * const found = std::memchr(data, *chars, size);
+        if (found)
+            size = static_cast<const unsigned char *>(found) - data;
+    }
+    return size;
+}
+
 static std::string escapeString(const std::string &str)
 {
     std::ostringstream ostr;
@@ -754,6 +800,12 @@ void simplecpp::TokenList::readfile(Stream &stream, const std::string &filename,
 
         if (ch <= ' ') {
             location.col++;
+            std::size_t size;
+            if (const unsigned char * const data = stream.unread(size)) {
+                const std::size_t blanks = countBlanks(data, size);
+                stream.skip(blanks);
+                location.col += blanks;
+            }
             continue;
         }
 
@@ -780,6 +832,12 @@ void simplecpp::TokenList::readfile(Stream &stream, const std::string &filename,
             const bool num = !!std::isdigit(ch);
             while (stream.good() && isNameChar(ch)) {
                 currentToken += ch;
+                std::size_t size;
+                if (const unsigned char * const data = stream.unread(size)) {
+                    const std::size_t n = countNameChars(data, size);
+                    currentToken.append(reinterpret_cast<const char *>(data), n);
+                    stream.skip(n);
+                }
                 ch = stream.readChar();
                 if (num && ch=='\'' && isNameChar(stream.peekChar()))
                     ch = stream.readChar();
@@ -792,6 +850,12 @@ void simplecpp::TokenList::readfile(Stream &stream, const std::string &filename,
         else if (ch == '/' && stream.peekChar() == '/') {
             while (stream.good() && ch != '\n') {
                 currentToken += ch;
+                std::size_t size;
+                if (const unsigned char * const data = stream.unread(size)) {
+                    const std::size_t n = findFirstOf(data, size, "\n\r\\");
+                    currentToken.append(reinterpret_cast<const char *>(data), n);
+                    stream.skip(n);
+                }
                 ch = stream.readChar();
                 if (ch == '\\') {
                     TokenString tmp;
@@ -832,6 +896,14 @@ void simplecpp::TokenList::readfile(Stream &stream, const std::string &filename,
                 currentToken += ch;
                 if (currentToken.size() >= 4U && endsWith(currentToken, COMMENT_END))
                     break;
+                std::size_t size;
+                const unsigned char * const data = (ch != '*') ? stream.unread(size) : nullptr;
+                if (data) {
+                    // the comment does not end before the next '*'
+                    const std::size_t n = findFirstOf(data, size, "*\r");
+                    currentToken.append(reinterpret_cast<const char *>(data), n);
+                    stream.skip(n);
+                }
                 ch = stream.readChar();
             }
             // multiline..
@@ -1407,6 +1479,14 @@ std::string simplecpp::TokenList::readUntil(Stream &stream, const Location &loca
         }
         backslash = false;
         ret += ch;
+        std::size_t size;
+        const unsigned char * const data = (ch != end && ch != '\\' && ch != '\r' && ch != '\n') ? stream.unread(size) : nullptr;
+        if (data) {
+            const char chars[] = {'\n', end, '\\', '\r', '\0'};
+            const std::size_t n = findFirstOf(data, size, chars);
+            ret.append(reinterpret_cast<const char *>(data), n);
+            stream.skip(n);
+        }
         if (ch == '\\') {
             bool update_ch = false;
             char next = 0;
@@ -1486,6 +1566,36 @@ namespace simplecpp {
     class Macro;
     using MacroMap = std::unordered_map<TokenString,Macro>;
 
+    /** When set, the macros used by the expansion in progress are recorded here (see MacroExpansionCache) */
+    static thread_local std::vector<const Macro *> *usedMacrosRecorder = nullptr;
+
+    /** Maps the file indexes of locations from one list of files to another one */
+    class FileIndexMap {
+    public:
+        FileIndexMap(const std::vector<std::string> &from, std::vector<std::string> &to) : mFrom(from), mTo(to) {}
+
+        Location operator()(Location location) {
+            if (location.fileIndex >= mFrom.size())
+                return location;
+            if (mMap.size() <= location.fileIndex)
+                mMap.resize(mFrom.size(), UINT_MAX);
+            unsigned int &fileIndex = mMap[location.fileIndex];
+            if (fileIndex == UINT_MAX) {
+                const std::vector<std::string>::const_iterator it = std::find(mTo.cbegin(), mTo.cend(), mFrom[location.fileIndex]);
+                fileIndex = static_cast<unsigned int>(it - mTo.cbegin());
+                if (it == mTo.cend())
+                    mTo.push_back(mFrom[location.fileIndex]);
+            }
+            location.fileIndex = fileIndex;
+            return location;
+        }
+
+    private:
+        const std::vector<std::string> &mFrom;
+        std::vector<std::string> &mTo;
+        std::vector<unsigned int> mMap;
+    };
+
     class Macro {
     public:
         explicit Macro(std::vector<std::string> &f) : nameTokDef(nullptr), valueToken(nullptr), endToken(nullptr), files(f), tokenListDefine(f), variadic(false), variadicOpt(false), valueDefinedInCode_(false) {}
@@ -1520,6 +1630,22 @@ namespace simplecpp {
                 throw std::runtime_error("bad macro syntax. macroname=" + name + " value=" + value);
         }
 
+        /**
+         * Copy of a macro for another list of files. The locations of the
+         * definition (if it is defined in the code) and of the usage are mapped
+         * to the new list of files.
+         */
+        Macro(const Macro &other, std::vector<std::string> &f, FileIndexMap &fileIndexMap) : nameTokDef(nullptr), files(f), tokenListDefine(f), valueDefinedInCode_(other.valueDefinedInCode_) {
+            for (const Token *tok = other.nameTokDef; sameline(tok, other.nameTokDef); tok = tok->next) {
+                Token * const copy = new Token(tok->str(), valueDefinedInCode_ ? fileIndexMap(tok->location) : tok->location, tok->whitespaceahead);
+                copy->macro = tok->macro;
+                tokenListDefine.push_back(copy);
+            }
+            parseDefine(tokenListDefine.cfront());
+            for (const Location &location : other.usageList)
+                usageList.push_back(fileIndexMap(location));
+        }
+
         Macro(const Macro &other) : nameTokDef(nullptr), files(other.files), tokenListDefine(other.files), valueDefinedInCode_(other.valueDefinedInCode_) {
             // TODO: remove the try-catch - see #537
             // avoid bugprone-exception-escape clang-tidy warning
@@ -1669,6 +1795,13 @@ namespace simplecpp {
             return usageList;
         }
 
+        /** add a usage of this macro */
+        void addUsage(const Location &loc) const {
+            usageList.push_back(loc);
+            if (usedMacrosRecorder)
+                usedMacrosRecorder->push_back(this);
+        }
+
         /** is this a function like macro */
         bool functionLike() const {
             return nameTokDef->next &&
@@ -1893,7 +2026,7 @@ namespace simplecpp {
             std::cout << "  expand " << name() << " " << locstring(defineLocation()) << std::endl;
 #endif
 
-            usageList.push_back(loc);
+            addUsage(loc);
 
             if (nameTokInst->str() == "__FILE__") {
                 output.push_back(new Token('\"'+output.file(loc)+'\"', loc));
@@ -1953,7 +2086,7 @@ namespace simplecpp {
                     for (const Token *tok = parametertokens1[0]; tok && par < parametertokens1.size(); tok = tok->next) {
                         if (tok->str() == "__COUNTER__") {
                             tokensparams.push_back(new Token(toString(counterMacro.usageList.size()), tok->location));
-                            counterMacro.usageList.push_back(tok->location);
+                            counterMacro.addUsage(tok->location);
                         } else {
                             tokensparams.push_back(new Token(*tok));
                             if (tok == parametertokens1[par]) {
@@ -2418,6 +2551,152 @@ namespace simplecpp {
         /** was the value of this macro actually defined in the code? */
         bool valueDefinedInCode_;
     };
+
+    /**
+     * Cache for the expansions of macro calls. The expansion only depends on
+     * the macro definitions and on the tokens of the call. So a call with the
+     * same tokens gets a copy of the cached tokens with only the location
+     * rewritten. The cache must be cleared when a macro is defined or undefined.
+     */
+    class MacroExpansionCache {
+    public:
+        explicit MacroExpansionCache(MacroExpansionStats *stats) : mStats(stats) {}
+
+        /** Records the macros used by expansions while it is alive */
+        class UsageRecorder {
+        public:
+            explicit UsageRecorder(std::vector<const Macro *> *usedMacros) {
+                usedMacrosRecorder = usedMacros;
+            }
+            ~UsageRecorder() {
+                usedMacrosRecorder = nullptr;
+            }
+            UsageRecorder(const UsageRecorder &) = delete;
+            UsageRecorder &operator=(const UsageRecorder &) = delete;
+        };
+
+        void clear() {
+            mEntries.clear();
+        }
+
+        /**
+         * Get the key of a macro call
+         * @param macro    the called macro
+         * @param nameTok  the macro name in the call
+         * @param end      output: the token after the call
+         * @return key or an empty string if the call can not be cached
+         */
+        static std::string key(const Macro &macro, const Token *nameTok, const Token *&end) {
+            end = nameTok->next;
+            if (macro.functionLike() && end && end->op == '(') {
+                unsigned int par = 0;
+                for (; end; end = end->next) {
+                    if (end->op == '(')
+                        ++par;
+                    else if (end->op == ')' && --par == 0U)
+                        break;
+                    else if (end->op == '#' && !sameline(end->previous, end))
+                        return ""; // invalid directive in the call
+                }
+                if (!end)
+                    return "";
+                end = end->next;
+            }
+
+            const Macro * const macroPtr = &macro;
+            std::string ret(reinterpret_cast<const char *>(&macroPtr), sizeof(macroPtr));
+            for (const Token *tok = nameTok; tok != end; tok = tok->next) {
+                ret += tok->str();
+                ret += tok->whitespaceahead ? '\1' : '\0';
+            }
+            return ret;
+        }
+
+        /** Append the cached expansion for the given key to output. Returns false if there is none. */
+        bool get(TokenList &output, const std::string &key, const Location &loc) const {
+            const std::unordered_map<std::string, Entry>::const_iterator it = mEntries.find(key);
+            if (it == mEntries.cend())
+                return false;
+            for (const Token &tok : it->second.tokens) {
+                auto *newtok = new Token(tok);
+                newtok->location = loc;
+                output.push_back(newtok);
+            }
+            for (const Macro *macro : it->second.usedMacros)
+                macro->addUsage(loc);
+            if (mStats)
+                ++mStats->hits;
+            return true;
+        }
+
+        /**
+         * Store the expansion of a call
+         * @param key         key of the call
+         * @param value       the expanded tokens
+         * @param usedMacros  the macros which were used by the expansion
+         * @param loc         location of the call
+         * @param macros      the macro definitions
+         */
+        void put(std::string key, const TokenList &value, std::vector<const Macro *> usedMacros, const Location &loc, const MacroMap &macros) {
+            if (!cacheable(value, usedMacros, loc, macros)) {
+                uncached();
+                return;
+            }
+            Entry &entry = mEntries[std::move(key)];
+            for (const Token *tok = value.cfront(); tok; tok = tok->next)
+                entry.tokens.emplace_back(*tok);
+            entry.usedMacros = std::move(usedMacros);
+            if (mStats)
+                ++mStats->misses;
+        }
+
+        /** count an expansion which can not be cached */
+        void uncached() {
+            if (mStats)
+                ++mStats->uncached;
+        }
+
+    private:
+        static bool cacheable(const TokenList &value, const std::vector<const Macro *> &usedMacros, const Location &loc, const MacroMap &macros) {
+            // the expansion depends on the location of the call
+            for (const Macro *macro : usedMacros) {
+                if (macro->name() == "__FILE__" || macro->name() == "__LINE__" || macro->name() == "__COUNTER__")
+                    return false;
+            }
+            for (const Token *tok = value.cfront(); tok; tok = tok->next) {
+                if (tok->location.fileIndex != loc.fileIndex || tok->location.line != loc.line || tok->location.col != loc.col)
+                    return false;
+            }
+
+            // the expansion might continue with the tokens after the call - see Macro::expand()
+            const Token *macro2tok = value.cback();
+            unsigned int par = 0;
+            while (macro2tok) {
+                if (macro2tok->op == '(') {
+                    if (par == 0)
+                        break;
+                    --par;
+                } else if (macro2tok->op == ')')
+                    ++par;
+                macro2tok = macro2tok->previous;
+            }
+            macro2tok = macro2tok ? macro2tok->previous : value.cback();
+            if (macro2tok && macro2tok->name) {
+                const MacroMap::const_iterator it = macros.find(macro2tok->str());
+                if (it != macros.cend() && it->second.functionLike())
+                    return false;
+            }
+            return true;
+        }
+
+        struct Entry {
+            std::vector<Token> tokens;
+            std::vector<const Macro *> usedMacros;
+        };
+
+        std::unordered_map<std::string, Entry> mEntries;
+        MacroExpansionStats *mStats;
+    };
 }
 
 namespace simplecpp {
@@ -2978,6 +3257,54 @@ static const simplecpp::Token *gotoNextLine(const simplecpp::Token *tok)
     return tok;
 }
 
+static const simplecpp::Token *skipComments(const simplecpp::Token *tok)
+{
+    while (tok && tok->comment)
+        tok = tok->next;
+    return tok;
+}
+
+/**
+ * Get the macro of the include guard. The whole file must be wrapped in
+ * "#ifndef X ... #endif" without #else/#elif so it has no effect at all when X is
+ * defined. Files with a directive that would cause an error in the skipped code
+ * are not considered to have an include guard.
+ * @return the macro name in the #ifndef or nullptr
+ */
+static const simplecpp::Token *findIncludeGuard(const simplecpp::TokenList &tokens)
+{
+    const simplecpp::Token *tok = skipComments(tokens.cfront());
+    if (!tok || tok->op != '#' || !sameline(tok, tok->next) || tok->next->str() != IFNDEF)
+        return nullptr;
+    const simplecpp::Token * const guardtok = tok->next->next;
+    if (!sameline(tok, guardtok) || !guardtok->name || guardtok->str() == HAS_INCLUDE)
+        return nullptr;
+
+    unsigned int depth = 1;
+    for (tok = gotoNextLine(guardtok); tok; tok = tok->next) {
+        if (tok->op != '#' || sameline(tok->previousSkipComments(), tok) || !sameline(tok, tok->next))
+            continue;
+        const simplecpp::TokenString &directive = tok->next->str();
+        if (directive == IF || directive == IFDEF || directive == IFNDEF || directive == ELIF) {
+            if (!sameline(tok, tok->next->next))
+                return nullptr;
+            if (directive == ELIF && depth == 1)
+                return nullptr;
+            if (directive != ELIF)
+                ++depth;
+        } else if (directive == ELSE) {
+            if (depth == 1)
+                return nullptr;
+        } else if (directive == ENDIF) {
+            if (--depth == 0)
+                break;
+        }
+    }
+    if (!tok || skipComments(gotoNextLine(tok)))
+        return nullptr;
+    return guardtok;
+}
+
 #ifdef SIMPLECPP_WINDOWS
 
 class NonExistingFilesCache {
@@ -3008,6 +3335,126 @@ static NonExistingFilesCache nonExistingFilesCache;
 
 #endif
 
+/**
+ * Process-wide cache of the entries of directories. It is used to skip the
+ * lookup of headers which do not exist, e.g. when a header is searched on many
+ * include paths. The listing of a directory is validated against its
+ * modification time once per FileDataCache and read again when it has changed.
+ */
+class DirectoryCache {
+public:
+    /**
+     * @param path         simplified path of a file
+     * @param checkedDirs  the directories which have already been validated by the caller
+     * @return false if the file is known not to exist
+     */
+    bool mayExist(const std::string &path, std::unordered_set<std::string> &checkedDirs) {
+        const std::string::size_type sep = path.rfind('/');
+        const std::string dir = (sep == std::string::npos) ? "." : (sep == 0) ? "/" : path.substr(0, sep);
+        const std::string name = (sep == std::string::npos) ? path : path.substr(sep + 1);
+        if (name.empty())
+            return true;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        Listing &listing = mListings[dir];
+        if (checkedDirs.insert(dir).second || !listing.read) {
+            const std::time_t now = std::time(nullptr);
+            long long mtime = 0;
+            const State state = getState(dir, mtime);
+            if (!listing.read || listing.racy || state != listing.state || mtime != listing.mtime) {
+                listing.state = state;
+                listing.mtime = mtime;
+                // the directory might be changed again within the same second
+                listing.racy = (state == State::Exists && mtime >= now);
+                listing.entries.clear();
+                if (state == State::Exists && !readEntries(dir, listing.entries))
+                    listing.state = State::Unknown;
+                listing.read = true;
+            }
+        }
+        if (listing.state == State::Unknown)
+            return true;
+        return listing.entries.find(toLower(name)) != listing.entries.end();
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mListings.clear();
+    }
+
+private:
+    enum class State : std::uint8_t { Unknown, Missing, Exists };
+
+    struct Listing {
+        bool read{};
+        bool racy{};
+        State state{State::Unknown};
+        long long mtime{};
+        /** lowercase names so case insensitive file systems are handled */
+        std::unordered_set<std::string> entries;
+    };
+
+    static std::string toLower(std::string s) {
+        std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) {
+            return static_cast<char>(std::tolower(c));
+        });
+        return s;
+    }
+
+#ifdef _WIN32
+    static State getState(const std::string &dir, long long &mtime) {
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (!GetFileAttributesExA(dir.c_str(), GetFileExInfoStandard, &data)) {
+            const DWORD err = GetLastError();
+            return (err == ERROR_FILE_NOT_FOUND || err == ERROR_PATH_NOT_FOUND) ? State::Missing : State::Unknown;
+        }
+        if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+            return State::Missing;
+        const unsigned long long filetime = (static_cast<unsigned long long>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+        // 100ns intervals since 1601 => seconds since 1970
+        mtime = static_cast<long long>(filetime / 10000000ULL) - 11644473600LL;
+        return State::Exists;
+    }
+
+    static bool readEntries(const std::string &dir, std::unordered_set<std::string> &entries) {
+        WIN32_FIND_DATAA data;
+        const HANDLE hFind = FindFirstFileA((dir + "/*").c_str(), &data);
+        if (hFind == INVALID_HANDLE_VALUE)
+            return false;
+        do {
+            entries.insert(toLower(data.cFileName));
+        } while (FindNextFileA(hFind, &data));
+        FindClose(hFind);
+        return true;
+    }
+#else
+    static State getState(const std::string &dir, long long &mtime) {
+        struct stat statbuf;
+        if (stat(dir.c_str(), &statbuf) != 0)
+            return (errno == ENOENT || errno == ENOTDIR) ? State::Missing : State::Unknown;
+        if (!S_ISDIR(statbuf.st_mode))
+            return State::Missing;
+        mtime = static_cast<long long>(statbuf.st_mtime);
+        return State::Exists;
+    }
+
+    static bool readEntries(const std::string &dir, std::unordered_set<std::string> &entries) {
+        DIR *d = opendir(dir.c_str());
+        if (!d)
+            return false;
+        while (const struct dirent *entry = readdir(d))
+            entries.insert(toLower(entry->d_name));
+        closedir(d);
+        return true;
+    }
+#endif
+
+    std::unordered_map<std::string, Listing> mListings;
+    std::mutex mMutex;
+};
+
+static DirectoryCache directoryCache;
+
 static std::string openHeaderDirect(std::ifstream &f, const std::string &path)
 {
 #ifdef SIMPLECPP_WINDOWS
@@ -3050,7 +3497,7 @@ std::pair<simplecpp::FileData *, bool> simplecpp::FileDataCache::tryload(FileDat
     const std::string &path = name_it->first;
     FileID fileId;
 
-    if (!getFileId(path, fileId))
+    if (!directoryCache.mayExist(path, mCheckedDirs) || !getFileId(path, fileId))
         return {nullptr, false};
 
     const auto id_it = mIdMap.find(fileId);
@@ -3059,7 +3506,7 @@ std::pair<simplecpp::FileData *, bool> simplecpp::FileDataCache::tryload(FileDat
         return {id_it->second, false};
     }
 
-    auto *const data = new FileData {path, TokenList(path, filenames, outputList)};
+    auto *const data = new FileData {path, mLoader ? mLoader(path, filenames, outputList) : TokenList(path, filenames, outputList), std::string(), Location(), false};
 
     if (dui.removeComments)
         data->tokens.removeComments();
@@ -3159,10 +3606,12 @@ bool simplecpp::FileDataCache::getFileId(const std::string &path, FileID &id)
 
 simplecpp::FileDataCache simplecpp::load(const simplecpp::TokenList &rawtokens, std::vector<std::string> &filenames, const simplecpp::DUI &dui, simplecpp::OutputList *outputList, FileDataCache cache)
 {
+    if (dui.clearIncludeCache) {
 #ifdef SIMPLECPP_WINDOWS
-    if (dui.clearIncludeCache)
         nonExistingFilesCache.clear();
 #endif
+        directoryCache.clear();
+    }
 
     std::list<const Token *> filelist;
 
@@ -3240,13 +3689,24 @@ simplecpp::FileDataCache simplecpp::load(const simplecpp::TokenList &rawtokens,
     return cache;
 }
 
-static bool preprocessToken(simplecpp::TokenList &output, const simplecpp::Token *&tok1, simplecpp::MacroMap &macros, std::vector<std::string> &files, simplecpp::OutputList *outputList)
+static bool preprocessToken(simplecpp::TokenList &output, const simplecpp::Token *&tok1, simplecpp::MacroMap &macros, std::vector<std::string> &files, simplecpp::OutputList *outputList, simplecpp::MacroExpansionCache &expansionCache)
 {
     const simplecpp::Token * const tok = tok1;
     const simplecpp::MacroMap::const_iterator it = tok->name ? macros.find(tok->str()) : macros.end();
     if (it != macros.end()) {
+        const simplecpp::Token *end = nullptr;
+        std::string key = simplecpp::MacroExpansionCache::key(it->second, tok, end);
+        if (key.empty())
+            expansionCache.uncached();
+        else if (expansionCache.get(output, key, tok->location)) {
+            tok1 = end;
+            return true;
+        }
+
         simplecpp::TokenList value(files);
+        std::vector<const simplecpp::Macro *> usedMacros;
         try {
+            const simplecpp::MacroExpansionCache::UsageRecorder recorder(key.empty() ? nullptr : &usedMacros);
             tok1 = it->second.expand(value, tok, macros, files);
         } catch (const simplecpp::Macro::Error &err) {
             if (outputList) {
@@ -3259,6 +3719,12 @@ static bool preprocessToken(simplecpp::TokenList &output, const simplecpp::Token
             }
             return false;
         }
+        if (!key.empty()) {
+            if (tok1 == end)
+                expansionCache.put(std::move(key), value, std::move(usedMacros), tok->location, macros);
+            else
+                expansionCache.uncached();
+        }
         output.takeTokens(value);
     } else {
         if (!tok->comment)
@@ -3294,12 +3760,229 @@ static std::string getTimeDefine(const struct tm *timep)
     return std::string("\"").append(buf).append("\"");
 }
 
-void simplecpp::preprocess(simplecpp::TokenList &output, const simplecpp::TokenList &rawtokens, std::vector<std::string> &files, simplecpp::FileDataCache &cache, const simplecpp::DUI &dui, simplecpp::OutputList *outputList, std::list<simplecpp::MacroUsage> *macroUsage, std::list<simplecpp::IfCond> *ifCond)
+/** Get the modification time and the size of a file */
+static bool getFileStamp(const std::string &path, std::pair<long long, long long> &stamp)
+{
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data))
+        return false;
+    stamp.first = static_cast<long long>((static_cast<unsigned long long>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime);
+    stamp.second = static_cast<long long>((static_cast<unsigned long long>(data.nFileSizeHigh) << 32) | data.nFileSizeLow);
+#else
+    struct stat statbuf;
+    if (stat(path.c_str(), &statbuf) != 0)
+        return false;
+    stamp.first = static_cast<long long>(statbuf.st_mtime);
+    stamp.second = static_cast<long long>(statbuf.st_size);
+#endif
+    return true;
+}
+
+struct simplecpp::MacroStateCache::Snapshot {
+    /** the files which the locations refer to */
+    std::vector<std::string> files;
+    /** the files of the macros which are not defined in the code (-D) */
+    std::vector<std::string> dummy;
+    /** the files which have been read with their modification time and size */
+    std::vector<std::pair<std::string, std::pair<long long, long long>>> inputs;
+    std::list<Macro> macros;
+    TokenList output{files};
+    OutputList outputList;
+    std::list<IfCond> ifCond;
+    std::map<std::string, std::list<Location>> maybeUsedMacros;
+    std::set<std::string> pragmaOnce;
+};
+
+std::shared_ptr<const simplecpp::MacroStateCache::Snapshot> simplecpp::MacroStateCache::find(const std::string &key)
+{
+    std::shared_ptr<const Snapshot> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        const auto it = mSnapshots.find(key);
+        if (it == mSnapshots.end())
+            return nullptr;
+        snapshot = it->second;
+    }
+
+    for (const auto &input : snapshot->inputs) {
+        std::pair<long long, long long> stamp;
+        if (!getFileStamp(input.first, stamp) || stamp != input.second) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            const auto it = mSnapshots.find(key);
+            if (it != mSnapshots.end() && it->second == snapshot)
+                mSnapshots.erase(it);
+            return nullptr;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    ++mHits;
+    return snapshot;
+}
+
+void simplecpp::MacroStateCache::insert(const std::string &key, std::shared_ptr<const Snapshot> snapshot)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mSnapshots.size() < maxSize || mSnapshots.find(key) != mSnapshots.end())
+        mSnapshots[key] = std::move(snapshot);
+}
+
+void simplecpp::MacroStateCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSnapshots.clear();
+}
+
+std::size_t simplecpp::MacroStateCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mSnapshots.size();
+}
+
+unsigned long long simplecpp::MacroStateCache::hits() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHits;
+}
+
+/** The settings which the macro state after the forced includes depends on */
+static std::string getMacroStateKey(const simplecpp::DUI &dui, const std::map<std::string, std::size_t> &sizeOfType)
 {
+    std::ostringstream ostr;
+    ostr << dui.std << '\n' << dui.removeComments << '\n';
+    for (const std::string &define : dui.defines)
+        ostr << "D" << define << '\n';
+    for (const std::string &undefined : dui.undefined)
+        ostr << "U" << undefined << '\n';
+    for (const std::string &includePath : dui.includePaths)
+        ostr << "I" << includePath << '\n';
+    for (const std::string &include : dui.includes)
+        ostr << "F" << include << '\n';
+    for (const auto &type : sizeOfType)
+        ostr << "S" << type.first << '=' << type.second << '\n';
+    return ostr.str();
+}
+
+/** Records what the preprocessing of the forced includes depends on and creates the snapshot of it */
+class MacroStateRecorder {
+public:
+    MacroStateRecorder(const simplecpp::OutputList &outputList, const std::list<simplecpp::IfCond> &ifCond)
+        : mOutputListSize(outputList.size()), mIfCondSize(ifCond.size()) {}
+
+    void addInput(const std::string &filename) {
+        mInputs.insert(filename);
+    }
+
+    /** the result of __has_include depends on the file system */
+    void setUsesHasInclude() {
+        mCacheable = false;
+    }
+
+    void checkCondition(const simplecpp::TokenList &expr) {
+        for (const simplecpp::Token *tok = expr.cfront(); tok; tok = tok->next) {
+            if (tok->str() == HAS_INCLUDE)
+                setUsesHasInclude();
+        }
+    }
+
+    std::shared_ptr<const simplecpp::MacroStateCache::Snapshot> snapshot(const simplecpp::MacroMap &macros,
+                                                                          const simplecpp::TokenList &output,
+                                                                          std::vector<std::string> &files,
+                                                                          const simplecpp::OutputList &outputList,
+                                                                          const std::list<simplecpp::IfCond> &ifCond,
+                                                                          const std::map<std::string, std::list<simplecpp::Location>> &maybeUsedMacros,
+                                                                          const std::set<std::string> &pragmaOnce) const {
+        if (!mCacheable)
+            return nullptr;
+
+        std::shared_ptr<simplecpp::MacroStateCache::Snapshot> snapshot = std::make_shared<simplecpp::MacroStateCache::Snapshot>();
+        for (const std::string &filename : mInputs) {
+            std::pair<long long, long long> stamp;
+            if (!getFileStamp(filename, stamp))
+                return nullptr;
+            snapshot->inputs.emplace_back(filename, stamp);
+        }
+
+        simplecpp::FileIndexMap fileIndexMap(files, snapshot->files);
+        for (const std::pair<const simplecpp::TokenString, simplecpp::Macro> &macro : macros)
+            snapshot->macros.emplace_back(macro.second, macro.second.valueDefinedInCode() ? snapshot->files : snapshot->dummy, fileIndexMap);
+        for (const simplecpp::Token *tok = output.cfront(); tok; tok = tok->next) {
+            simplecpp::Token * const copy = new simplecpp::Token(tok->str(), fileIndexMap(tok->location), tok->whitespaceahead);
+            copy->macro = tok->macro;
+            snapshot->output.push_back(copy);
+        }
+        for (auto it = std::next(outputList.cbegin(), mOutputListSize); it != outputList.cend(); ++it) {
+            simplecpp::Output out = *it;
+            out.location = fileIndexMap(out.location);
+            snapshot->outputList.push_back(std::move(out));
+        }
+        for (auto it = std::next(ifCond.cbegin(), mIfCondSize); it != ifCond.cend(); ++it)
+            snapshot->ifCond.emplace_back(fileIndexMap(it->location), it->E, it->result);
+        for (const auto &usage : maybeUsedMacros) {
+            std::list<simplecpp::Location> &locations = snapshot->maybeUsedMacros[usage.first];
+            for (const simplecpp::Location &location : usage.second)
+                locations.push_back(fileIndexMap(location));
+        }
+        snapshot->pragmaOnce = pragmaOnce;
+        return snapshot;
+    }
+
+private:
+    std::size_t mOutputListSize;
+    std::size_t mIfCondSize;
+    std::set<std::string> mInputs;
+    bool mCacheable{true};
+};
+
+/** Continue from the macro state after the forced includes of a previous file */
+static void restoreMacroState(const simplecpp::MacroStateCache::Snapshot &snapshot,
+                              simplecpp::MacroMap &macros,
+                              simplecpp::TokenList &output,
+                              std::vector<std::string> &files,
+                              std::vector<std::string> &dummy,
+                              simplecpp::OutputList *outputList,
+                              std::list<simplecpp::IfCond> *ifCond,
+                              std::map<std::string, std::list<simplecpp::Location>> &maybeUsedMacros,
+                              std::set<std::string> &pragmaOnce)
+{
+    simplecpp::FileIndexMap fileIndexMap(snapshot.files, files);
+    macros.clear();
+    for (const simplecpp::Macro &macro : snapshot.macros)
+        macros.insert(std::make_pair(macro.name(), simplecpp::Macro(macro, macro.valueDefinedInCode() ? files : dummy, fileIndexMap)));
+    for (const simplecpp::Token *tok = snapshot.output.cfront(); tok; tok = tok->next) {
+        simplecpp::Token * const copy = new simplecpp::Token(tok->str(), fileIndexMap(tok->location), tok->whitespaceahead);
+        copy->macro = tok->macro;
+        output.push_back(copy);
+    }
+    if (outputList) {
+        for (simplecpp::Output out : snapshot.outputList) {
+            out.location = fileIndexMap(out.location);
+            outputList->push_back(std::move(out));
+        }
+    }
+    if (ifCond) {
+        for (const simplecpp::IfCond &cond : snapshot.ifCond)
+            ifCond->emplace_back(fileIndexMap(cond.location), cond.E, cond.result);
+    }
+    for (const auto &usage : snapshot.maybeUsedMacros) {
+        std::list<simplecpp::Location> &locations = maybeUsedMacros[usage.first];
+        for (const simplecpp::Location &location : usage.second)
+            locations.push_back(fileIndexMap(location));
+    }
+    pragmaOnce = snapshot.pragmaOnce;
+}
+
+void simplecpp::preprocess(simplecpp::TokenList &output, const simplecpp::TokenList &rawtokens, std::vector<std::string> &files, simplecpp::FileDataCache &cache, const simplecpp::DUI &dui, simplecpp::OutputList *outputList, std::list<simplecpp::MacroUsage> *macroUsage, std::list<simplecpp::IfCond> *ifCond, simplecpp::MacroExpansionStats *expansionStats, simplecpp::MacroStateCache *macroStateCache)
+{
+    if (dui.clearIncludeCache) {
 #ifdef SIMPLECPP_WINDOWS
-    if (dui.clearIncludeCache)
         nonExistingFilesCache.clear();
 #endif
+        directoryCache.clear();
+        if (macroStateCache)
+            macroStateCache->clear();
+    }
 
     std::map<std::string, std::size_t> sizeOfType(rawtokens.sizeOfType);
     sizeOfType.insert(std::make_pair("char", sizeof(char)));
@@ -3328,6 +4011,7 @@ void simplecpp::preprocess(simplecpp::TokenList &output, const simplecpp::TokenL
 
     const bool hasInclude = isCpp17OrLater(dui) || isGnu(dui);
     MacroMap macros;
+    MacroExpansionCache expansionCache(expansionStats);
     bool strictAnsiDefined = false;
     for (auto it = dui.defines.cbegin(); it != dui.defines.cend(); ++it) {
         const std::string &macrostr = *it;
@@ -3394,19 +4078,45 @@ void simplecpp::preprocess(simplecpp::TokenList &output, const simplecpp::TokenL
 
     std::set<std::string> pragmaOnce;
 
-    includetokenstack.push(rawtokens.cfront());
-    for (auto it = dui.includes.cbegin(); it != dui.includes.cend(); ++it) {
-        const FileData *const filedata = cache.get("", *it, dui, false, files, outputList).first;
-        if (filedata != nullptr && filedata->tokens.cfront() != nullptr)
-            includetokenstack.push(filedata->tokens.cfront());
+    std::map<std::string, std::list<Location>> maybeUsedMacros;
+
+    // the macro state after the forced includes is reused by the files with the same settings
+    std::string macroStateKey;
+    std::shared_ptr<const MacroStateCache::Snapshot> macroState;
+    std::unique_ptr<MacroStateRecorder> macroStateRecorder;
+    if (macroStateCache && !dui.includes.empty() && rawtokens.cfront()) {
+        macroStateKey = getMacroStateKey(dui, sizeOfType);
+        macroState = macroStateCache->find(macroStateKey);
+        if (!macroState && outputList && ifCond && output.empty())
+            macroStateRecorder.reset(new MacroStateRecorder(*outputList, *ifCond));
     }
 
-    std::map<std::string, std::list<Location>> maybeUsedMacros;
+    includetokenstack.push(rawtokens.cfront());
+    if (macroState) {
+        restoreMacroState(*macroState, macros, output, files, dummy, outputList, ifCond, maybeUsedMacros, pragmaOnce);
+    } else {
+        for (auto it = dui.includes.cbegin(); it != dui.includes.cend(); ++it) {
+            const FileData *const filedata = cache.get("", *it, dui, false, files, outputList).first;
+            if (filedata != nullptr && macroStateRecorder)
+                macroStateRecorder->addInput(filedata->filename);
+            if (filedata != nullptr && filedata->tokens.cfront() != nullptr)
+                includetokenstack.push(filedata->tokens.cfront());
+        }
+    }
 
     for (const Token *rawtok = nullptr; rawtok || !includetokenstack.empty();) {
         if (rawtok == nullptr) {
             rawtok = includetokenstack.top();
             includetokenstack.pop();
+            if (macroStateRecorder && includetokenstack.empty()) {
+                // the forced includes have been preprocessed
+                if (ifstates.size() == 1U) {
+                    std::shared_ptr<const MacroStateCache::Snapshot> snapshot = macroStateRecorder->snapshot(macros, output, files, *outputList, *ifCond, maybeUsedMacros, pragmaOnce);
+                    if (snapshot)
+                        macroStateCache->insert(macroStateKey, std::move(snapshot));
+                }
+                macroStateRecorder.reset();
+            }
             continue;
         }
 
@@ -3468,6 +4178,7 @@ void simplecpp::preprocess(simplecpp::TokenList &output, const simplecpp::TokenL
                             macros.insert(std::pair<TokenString, Macro>(macro.name(), macro));
                         else
                             it->second = macro;
+                        expansionCache.clear();
                     }
                 } catch (const std::runtime_error &) {
                     if (outputList) {
@@ -3501,7 +4212,7 @@ void simplecpp::preprocess(simplecpp::TokenList &output, const simplecpp::TokenL
                 TokenList inc2(files);
                 if (!inc1.empty() && inc1.cfront()->name) {
                     const Token *inctok = inc1.cfront();
-                    if (!preprocessToken(inc2, inctok, macros, files, outputList)) {
+                    if (!preprocessToken(inc2, inctok, macros, files, outputList, expansionCache)) {
                         output.clear();
                         return;
                     }
@@ -3538,7 +4249,9 @@ void simplecpp::preprocess(simplecpp::TokenList &output, const simplecpp::TokenL
 
                 const bool systemheader = (inctok->str()[0] == '<');
                 const std::string header(inctok->str().substr(1U, inctok->str().size() - 2U));
-                const FileData *const filedata = cache.get(rawtokens.file(rawtok->location), header, dui, systemheader, files, outputList).first;
+                FileData *const filedata = cache.get(rawtokens.file(rawtok->location), header, dui, systemheader, files, outputList).first;
+                if (filedata != nullptr && macroStateRecorder)
+                    macroStateRecorder->addInput(filedata->filename);
                 if (filedata == nullptr) {
                     if (outputList) {
                         simplecpp::Output out = {
@@ -3558,9 +4271,22 @@ void simplecpp::preprocess(simplecpp::TokenList &output, const simplecpp::TokenL
                         outputList->push_back(std::move(out));
                     }
                 } else if (pragmaOnce.find(filedata->filename) == pragmaOnce.end()) {
-                    includetokenstack.push(gotoNextLine(rawtok));
-                    rawtok = filedata->tokens.cfront();
-                    continue;
+                    if (!filedata->includeGuardChecked) {
+                        const Token * const guardtok = findIncludeGuard(filedata->tokens);
+                        if (guardtok) {
+                            filedata->includeGuard = guardtok->str();
+                            filedata->includeGuardLocation = guardtok->location;
+                        }
+                        filedata->includeGuardChecked = true;
+                    }
+                    if (!filedata->includeGuard.empty() && macros.find(filedata->includeGuard) != macros.end()) {
+                        // the include guard is defined - the file would be skipped as a whole
+                        maybeUsedMacros[filedata->includeGuard].push_back(filedata->includeGuardLocation);
+                    } else {
+                        includetokenstack.push(gotoNextLine(rawtok));
+                        rawtok = filedata->tokens.cfront();
+                        continue;
+                    }
                 }
             } else if (rawtok->str() == IF || rawtok->str() == IFDEF || rawtok->str() == IFNDEF || rawtok->str() == ELIF) {
                 if (!sameline(rawtok,rawtok->next)) {
@@ -3645,6 +4371,8 @@ void simplecpp::preprocess(simplecpp::TokenList &output, const simplecpp::TokenL
                                     closingAngularBracket = true;
                                 }
                                 if (tok) {
+                                    if (macroStateRecorder)
+                                        macroStateRecorder->setUsesHasInclude();
                                     std::ifstream f;
                                     const std::string header2 = openHeader(f,dui,sourcefile,header,systemheader);
                                     expr.push_back(new Token(header2.empty() ? "0" : "1", tok->location));
@@ -3670,7 +4398,7 @@ void simplecpp::preprocess(simplecpp::TokenList &output, const simplecpp::TokenL
                         maybeUsedMacros[rawtok->next->str()].push_back(rawtok->next->location);
 
                         const Token *tmp = tok;
-                        if (!preprocessToken(expr, tmp, macros, files, outputList)) {
+                        if (!preprocessToken(expr, tmp, macros, files, outputList, expansionCache)) {
                             output.clear();
                             return;
                         }
@@ -3678,6 +4406,8 @@ void simplecpp::preprocess(simplecpp::TokenList &output, const simplecpp::TokenL
                             break;
                         tok = tmp->previous;
                     }
+                    if (macroStateRecorder && hasInclude)
+                        macroStateRecorder->checkCondition(expr);
                     try {
                         if (ifCond) {
                             std::string E;
@@ -3735,8 +4465,8 @@ void simplecpp::preprocess(simplecpp::TokenList &output, const simplecpp::TokenL
                     const Token *tok = rawtok->next;
                     while (sameline(rawtok,tok) && tok->comment)
                         tok = tok->next;
-                    if (sameline(rawtok, tok))
-                        macros.erase(tok->str());
+                    if (sameline(rawtok, tok) && macros.erase(tok->str()) > 0)
+                        expansionCache.clear();
                 }
             } else if (ifstates.top() == True && rawtok->str() == PRAGMA && rawtok->next && rawtok->next->str() == ONCE && sameline(rawtok,rawtok->next)) {
                 pragmaOnce.insert(rawtokens.file(rawtok->location));
@@ -3768,7 +4498,7 @@ void simplecpp::preprocess(simplecpp::TokenList &output, const simplecpp::TokenL
         const Location loc(rawtok->location);
         TokenList tokens(files);
 
-        if (!preprocessToken(tokens, rawtok, macros, files, outputList)) {
+        if (!preprocessToken(tokens, rawtok, macros, files, outputList, expansionCache)) {
             output.clear();
             return;
         }
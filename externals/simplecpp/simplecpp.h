@@ -9,13 +9,16 @@
 #include <cctype>
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <iosfwd>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 #if __cplusplus >= 202002L
@@ -419,6 +422,13 @@ namespace simplecpp {
         long long result; // condition result
     };
 
+    /** Counters of the macro expansion cache */
+    struct SIMPLECPP_LIB MacroExpansionStats {
+        unsigned long long hits{}; // expansions reused from the cache
+        unsigned long long misses{}; // expansions not found in the cache
+        unsigned long long uncached{}; // expansions which can not be cached (e.g. they use __LINE__)
+    };
+
     /**
      * Command line preprocessor settings.
      * On the command line these are configured by -D, -U, -I, --include, -std
@@ -439,6 +449,12 @@ namespace simplecpp {
         std::string filename;
         /** The tokens associated with this file */
         TokenList tokens;
+        /** The macro of the include guard ("#ifndef X / #define X ... #endif") or empty if there is none */
+        std::string includeGuard;
+        /** Location of the macro in the #ifndef of the include guard */
+        Location includeGuardLocation;
+        /** Has the file been checked for an include guard? */
+        bool includeGuardChecked;
     };
 
     class SIMPLECPP_LIB FileDataCache {
@@ -455,6 +471,13 @@ namespace simplecpp {
          *  returns the file data and true if the file was loaded, false if it was cached. */
         std::pair<FileData *, bool> get(const std::string &sourcefile, const std::string &header, const DUI &dui, bool systemheader, std::vector<std::string> &filenames, OutputList *outputList);
 
+        /** Function used to read the tokens of a file instead of reading the file directly */
+        using Loader = std::function<TokenList(const std::string &path, std::vector<std::string> &filenames, OutputList *outputList)>;
+
+        void setLoader(Loader loader) {
+            mLoader = std::move(loader);
+        }
+
         void insert(FileData data) {
             // NOLINTNEXTLINE(misc-const-correctness) - FP
             auto *const newdata = new FileData(std::move(data));
@@ -467,6 +490,7 @@ namespace simplecpp {
             mNameMap.clear();
             mIdMap.clear();
             mData.clear();
+            mCheckedDirs.clear();
         }
 
         using container_type = std::vector<std::unique_ptr<FileData>>;
@@ -542,6 +566,46 @@ namespace simplecpp {
         container_type mData;
         name_map_type mNameMap;
         id_map_type mIdMap;
+        Loader mLoader;
+        /** directories whose cached listing has been validated for this cache */
+        std::unordered_set<std::string> mCheckedDirs;
+    };
+
+    /**
+     * Snapshots of the macro state after the forced includes (DUI::includes).
+     * The forced includes are preprocessed once for each set of settings and
+     * the following files with the same settings start from the snapshot.
+     * A snapshot is dropped when one of the files that it was made from is
+     * modified. The cache is thread safe.
+     */
+    class SIMPLECPP_LIB MacroStateCache {
+    public:
+        struct Snapshot;
+
+        MacroStateCache() = default;
+
+        MacroStateCache(const MacroStateCache &) = delete;
+        MacroStateCache &operator=(const MacroStateCache &) = delete;
+
+        /** Get the valid snapshot for the key or nullptr if there is none */
+        std::shared_ptr<const Snapshot> find(const std::string &key);
+
+        void insert(const std::string &key, std::shared_ptr<const Snapshot> snapshot);
+
+        void clear();
+
+        std::size_t size() const;
+
+        /** count of snapshots that have been reused */
+        unsigned long long hits() const;
+
+    private:
+        /** the count of snapshots is limited to bound the memory usage */
+        static const std::size_t maxSize = 64;
+
+        std::unordered_map<std::string, std::shared_ptr<const Snapshot>> mSnapshots;
+        unsigned long long mHits{};
+        mutable std::mutex mMutex;
     };
 
     /** Converts character literal (including prefix, but not ud-suffix) to long long value.
@@ -587,8 +651,10 @@ namespace simplecpp {
      * @param outputList output: list that will receive output messages
      * @param macroUsage output: macro usage
      * @param ifCond output: #if/#elif expressions
+     * @param expansionStats output: counters of the macro expansion cache
+     * @param macroStateCache snapshots of the macro state after the forced includes
      */
-    SIMPLECPP_LIB void preprocess(TokenList &output, const TokenList &rawtokens, std::vector<std::string> &files, FileDataCache &cache, const DUI &dui, OutputList *outputList = nullptr, std::list<MacroUsage> *macroUsage = nullptr, std::list<IfCond> *ifCond = nullptr);
+    SIMPLECPP_LIB void preprocess(TokenList &output, const TokenList &rawtokens, std::vector<std::string> &files, FileDataCache &cache, const DUI &dui, OutputList *outputList = nullptr, std::list<MacroUsage> *macroUsage = nullptr, std::list<IfCond> *ifCond = nullptr, MacroExpansionStats *expansionStats = nullptr, MacroStateCache *macroStateCache = nullptr);
 
     /**
      * Deallocate data
@@ -1615,7 +1615,7 @@ bool isSameExpression(bool macro, const Token *tok1, const Token *tok2, const Se
     if (Token::simpleMatch(tok2, "!") && Token::simpleMatch(tok2->astOperand1(), "!") && !Token::simpleMatch(tok2->astParent(), "=") && astIsBoolLike(tok1, settings)) {
         return isSameExpression(macro, tok1, tok2->astOperand1()->astOperand1(), settings, pure, followVar, errors);
     }
-    const bool tok_str_eq = tok1->str() == tok2->str();
+    const bool tok_str_eq = Token::sameStr(tok1, tok2);
     if (!tok_str_eq && isDifferentKnownValues(tok1, tok2))
         return false;
 
@@ -1634,16 +1634,16 @@ bool isSameExpression(bool macro, const Token *tok1, const Token *tok2, const Se
     // Follow variable
     if (followVar && !tok_str_eq && (followTok1->varId() || followTok2->varId() || followTok1->enumerator() || followTok2->enumerator())) {
         const Token * varTok1 = followVariableExpression(settings, followTok1, followTok2);
-        if ((varTok1->str() == followTok2->str()) || isSameConstantValue(macro, varTok1, followTok2)) {
+        if (Token::sameStr(varTok1, followTok2) || isSameConstantValue(macro, varTok1, followTok2)) {
             followVariableExpressionError(followTok1, varTok1, errors);
             return isSameExpression(macro, varTok1, followTok2, settings, true, followVar, errors);
         }
         const Token * varTok2 = followVariableExpression(settings, followTok2, followTok1);
-        if ((followTok1->str() == varTok2->str()) || isSameConstantValue(macro, followTok1, varTok2)) {
+        if (Token::sameStr(followTok1, varTok2) || isSameConstantValue(macro, followTok1, varTok2)) {
             followVariableExpressionError(followTok2, varTok2, errors);
             return isSameExpression(macro, followTok1, varTok2, settings, true, followVar, errors);
         }
-        if ((varTok1->str() == varTok2->str()) || isSameConstantValue(macro, varTok1, varTok2)) {
+        if (Token::sameStr(varTok1, varTok2) || isSameConstantValue(macro, varTok1, varTok2)) {
             followVariableExpressionError(tok1, varTok1, errors);
             followVariableExpressionError(tok2, varTok2, errors);
             return isSameExpression(macro, varTok1, varTok2, settings, true, followVar, errors);
@@ -1755,7 +1755,7 @@ bool isSameExpression(bool macro, const Token *tok1, const Token *tok2, const Se
         const Token *end1 = t1->link();
         const Token *end2 = t2->link();
         while (t1 && t2 && t1 != end1 && t2 != end2) {
-            if (t1->str() != t2->str() || !compareTokenFlags(t1, t2, macro))
+            if (!Token::sameStr(t1, t2) || !compareTokenFlags(t1, t2, macro))
                 return false;
             t1 = t1->next();
             t2 = t2->next();
@@ -1775,7 +1775,7 @@ bool isSameExpression(bool macro, const Token *tok1, const Token *tok2, const Se
         const Token *t1 = tok1->next();
         const Token *t2 = tok2->next();
         while (t1 && t2 &&
-               t1->str() == t2->str() &&
+               Token::sameStr(t1, t2) &&
                compareTokenFlags(t1, t2, macro) &&
                (t1->isName() || t1->str() == "*")) {
             t1 = t1->next();
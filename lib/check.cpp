@@ -116,7 +116,7 @@ ErrorPath Check::getErrorPath(const Token* errtok, const ValueFlow::Value* value
     if (!value) {
         errorPath.emplace_back(errtok, std::move(bug));
     } else if (mSettings->verbose || mSettings->outputFormat == Settings::OutputFormat::xml || !mSettings->templateLocation.empty()) {
-        errorPath = value->errorPath;
+        errorPath = value->errorPath.toErrorPath();
         errorPath.emplace_back(errtok, std::move(bug));
     } else {
         if (value->condition)
@@ -225,7 +225,7 @@ static bool getDimensionsEtc(const Token * const arrayToken, const Settings &set
         if (!value)
             return false;
         path = value->path;
-        errorPath = value->errorPath;
+        errorPath = value->errorPath.toErrorPath();
         Dimension dim;
         dim.known = value->isKnown();
         dim.tok = nullptr;
@@ -1145,7 +1145,7 @@ void CheckBufferOverrun::objectIndexError(const Token *tok, const ValueFlow::Val
         while (Token::simpleMatch(expr->astParent(), "."))
             expr = expr->astParent();
         name = expr->expressionString();
-        errorPath = v->errorPath;
+        errorPath = v->errorPath.toErrorPath();
     }
     errorPath.emplace_back(tok, "");
     std::string verb = known ? "is" : "might be";
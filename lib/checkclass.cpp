@@ -2314,7 +2314,7 @@ bool CheckClass::isMemberVar(const Scope *scope, const Token *tok) const
             const Scope* curScope = scope;
             while (!isMember && curScope && curScope->type != ScopeType::eGlobal) {
                 scopeStr.insert(0, curScope->className + " :: ");
-                isMember = Token::Match(fqTok, scopeStr.c_str());
+                isMember = Token::Match(fqTok, scopeStr);
 
                 curScope = curScope->nestedIn;
             }
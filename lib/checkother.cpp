@@ -775,7 +775,7 @@ void CheckOther::redundantAssignmentInSwitchError(const Token *tok1, const Token
 
 void CheckOther::redundantAssignmentSameValueError(const Token *tok, const ValueFlow::Value* val, const std::string &var)
 {
-    auto errorPath = val->errorPath;
+    ErrorPath errorPath = val->errorPath.toErrorPath();
     errorPath.emplace_back(tok, "");
     reportError(std::move(errorPath), Severity::style, "redundantAssignment",
                 "$symbol:" + var + "\n"
@@ -4350,11 +4350,11 @@ void CheckOther::comparePointersError(const Token *tok, const ValueFlow::Value *
     const char * const id = (verb[0] == 'C') ? "comparePointers" : "subtractPointers";
     if (v1) {
         errorPath.emplace_back(v1->tokvalue->variable()->nameToken(), "Variable declared here.");
-        errorPath.insert(errorPath.end(), v1->errorPath.cbegin(), v1->errorPath.cend());
+        v1->errorPath.appendTo(errorPath);
     }
     if (v2) {
         errorPath.emplace_back(v2->tokvalue->variable()->nameToken(), "Variable declared here.");
-        errorPath.insert(errorPath.end(), v2->errorPath.cbegin(), v2->errorPath.cend());
+        v2->errorPath.appendTo(errorPath);
     }
     errorPath.emplace_back(tok, "");
     reportError(
@@ -1094,7 +1094,7 @@ static const ValueFlow::Value* getInnerLifetime(const Token* tok,
                 if (const ValueFlow::Value* v = getInnerLifetime(val.capturetok, id, errorPath, depth - 1))
                     return v;
             if (errorPath)
-                errorPath->insert(errorPath->end(), val.errorPath.cbegin(), val.errorPath.cend());
+                val.errorPath.appendTo(*errorPath);
             if (const ValueFlow::Value* v = getInnerLifetime(val.tokvalue, id, errorPath, depth - 1))
                 return v;
             continue;
@@ -1256,7 +1256,7 @@ void CheckStl::invalidContainerError(const Token *tok, const Token * /*contTok*/
 {
     const bool inconclusive = val ? val->isInconclusive() : false;
     if (val)
-        errorPath.insert(errorPath.begin(), val->errorPath.cbegin(), val->errorPath.cend());
+        errorPath.splice(errorPath.begin(), val->errorPath.toErrorPath());
     std::string msg = "Using " + lifetimeMessage(tok, val, errorPath);
     errorPath.emplace_back(tok, "");
     reportError(std::move(errorPath), Severity::error, "invalidContainer", msg + " that may be invalid.", CWE664, inconclusive ? Certainty::inconclusive : Certainty::normal);
@@ -2287,7 +2287,7 @@ void CheckStl::uselessCalls()
                         pattern += ' ';
                     }
                     pattern += "{|( %varid% . begin ( ) ,";
-                    if (Token::Match(tok, pattern.c_str(), tok->varId()))
+                    if (Token::Match(tok, pattern, tok->varId()))
                         uselessCallsConstructorError(tok);
                 }
             }
@@ -1577,11 +1577,11 @@ void CheckUninitVar::uninitvarError(const Token* tok, const ValueFlow::Value& v)
     if (tok && Token::simpleMatch(tok->astParent(), ".") && astIsRHS(tok))
         ltok = tok->astParent();
     const std::string& varname = ltok ? ltok->expressionString() : "x";
-    ErrorPath errorPath = v.errorPath;
+    ErrorPath errorPath = v.errorPath.toErrorPath();
     errorPath.emplace_back(tok, "");
     auto severity = v.isKnown() ? Severity::error : Severity::warning;
     auto certainty = v.isInconclusive() ? Certainty::inconclusive : Certainty::normal;
-    if (v.subexpressions.empty()) {
+    if (v.subexpressions().empty()) {
         reportError(std::move(errorPath),
                     severity,
                     "uninitvar",
@@ -1590,9 +1590,9 @@ void CheckUninitVar::uninitvarError(const Token* tok, const ValueFlow::Value& v)
                     certainty);
         return;
     }
-    std::string vars = v.subexpressions.size() == 1 ? "variable: " : "variables: ";
+    std::string vars = v.subexpressions().size() == 1 ? "variable: " : "variables: ";
     std::string prefix;
-    for (const std::string& var : v.subexpressions) {
+    for (const std::string& var : v.subexpressions()) {
         vars += prefix + varname + "." + var;
         prefix = ", ";
     }
@@ -1673,7 +1673,7 @@ void CheckUninitVar::valueFlowUninit()
                 const ExprUsage usage = getExprUsage(tok, v->indirect, *mSettings);
                 if (usage == ExprUsage::NotUsed || usage == ExprUsage::Inconclusive)
                     continue;
-                if (!v->subexpressions.empty() && usage == ExprUsage::PassedByReference)
+                if (!v->subexpressions().empty() && usage == ExprUsage::PassedByReference)
                     continue;
                 if (usage != ExprUsage::Used) {
                     if (!(Token::Match(tok->astParent(), ". %name% (|[") && uninitderef) &&
@@ -1558,9 +1558,10 @@ void CheckUnusedVar::checkStructMemberUsage()
             continue;
 
         // Bail out if struct is used in sizeof..
+        const std::string structPattern("struct| " + scope.className);
         for (const Token *tok = scope.bodyEnd; nullptr != (tok = Token::findsimplematch(tok, "sizeof ("));) {
             tok = tok->tokAt(2);
-            if (Token::Match(tok, ("struct| " + scope.className).c_str())) {
+            if (Token::Match(tok, structPattern)) {
                 bailout = true;
                 break;
             }
@@ -1619,6 +1620,7 @@ void CheckUnusedVar::checkStructMemberUsage()
                 continue;
         }
 
+        const std::string offsetofPattern("offsetof ( struct| " + scope.className + " , %name%");
         for (const Variable &var : scope.varlist) {
             // only warn for variables without side effects
             if (!var.typeStartToken()->isStandardType() && !var.isPointer() && !astIsContainer(var.nameToken()) && !mTokenizer->getSymbolDatabase()->isRecordTypeWithoutSideEffects(var.type()))
@@ -1641,7 +1643,7 @@ void CheckUnusedVar::checkStructMemberUsage()
                     break;
                 }
                 // Member referenced in offsetof
-                if (Token::Match(tok, ("offsetof ( struct| " + scope.className + " , %name%").c_str())) {
+                if (Token::Match(tok, offsetofPattern)) {
                     tok = Token::simpleMatch(tok->tokAt(2), "struct") ? tok->tokAt(5) : tok->tokAt(4);
                     if (tok->str() == var.name()) {
                         use = true;
@@ -1677,8 +1677,7 @@ void clangimport::parseClangAstDump(Tokenizer &tokenizer, std::istream &f)
             throw InternalError(tok, "Token::link() is not set properly");
     }
 
-    if (tokenList.front())
-        tokenList.front()->assignIndexes();
+    tokenList.createTokenIndex();
     symbolDatabase->clangSetVariables(data.getVariableList());
     symbolDatabase->createSymbolDatabaseExprIds();
     tokenList.clangSetOrigFiles();
@@ -49,17 +49,23 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdio>
 #include <cstdint>
 #include <cstring>
 #include <cctype>
 #include <cstdlib>
+#include <condition_variable>
 #include <ctime>
 #include <exception> // IWYU pragma: keep
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <new>
 #include <set>
 #include <sstream>
@@ -83,6 +89,19 @@ static constexpr char FILELIST[] = "cppcheck-addon-ctu-file-list";
 // CWE ids used
 static const CWE CWE398(398U);  // Indicator of Poor Code Quality
 
+using Location = std::pair<std::string, int>;
+using LocationMacros = std::map<Location, std::set<std::string>>; // What macros are used on a location?
+
+static LocationMacros getLocationMacros(const Token* startTok, const std::vector<std::string>& files)
+{
+    LocationMacros locationMacros;
+    for (const Token* tok = startTok; tok; tok = tok->next()) {
+        if (!tok->getMacroName().empty())
+            locationMacros[Location(files[tok->fileIndex()], tok->linenr())].emplace(tok->getMacroName());
+    }
+    return locationMacros;
+}
+
 class CppCheck::CppCheckLogger : public ErrorLogger
 {
 public:
@@ -103,13 +122,9 @@ public:
         mRemarkComments = std::move(remarkComments);
     }
 
-    void setLocationMacros(const Token* startTok, const std::vector<std::string>& files)
+    void setLocationMacros(LocationMacros locationMacros)
     {
-        mLocationMacros.clear();
-        for (const Token* tok = startTok; tok; tok = tok->next()) {
-            if (!tok->getMacroName().empty())
-                mLocationMacros[Location(files[tok->fileIndex()], tok->linenr())].emplace(tok->getMacroName());
-        }
+        mLocationMacros = std::move(locationMacros);
     }
 
     void resetExitCode()
@@ -271,8 +286,7 @@ private:
 
     std::vector<RemarkComment> mRemarkComments;
 
-    using Location = std::pair<std::string, int>;
-    std::map<Location, std::set<std::string>> mLocationMacros; // What macros are used on a location?
+    LocationMacros mLocationMacros;
 
     std::ofstream mPlistFile;
 
@@ -297,6 +311,147 @@ namespace {
     private:
         std::vector<std::string> mFilenames;
     };
+
+    /** Keeps the messages until they can be passed on in the order of the configurations */
+    class DeferredErrorLogger : public ErrorLogger {
+    public:
+        void reportOut(const std::string &outmsg, Color c) override {
+            if (mErrorLogger)
+                mErrorLogger->reportOut(outmsg, c);
+            else
+                mMessages.emplace_back([=](ErrorLogger &errorLogger) {
+                    errorLogger.reportOut(outmsg, c);
+                });
+        }
+
+        void reportErr(const ErrorMessage &msg) override {
+            if (mErrorLogger)
+                mErrorLogger->reportErr(msg);
+            else
+                mMessages.emplace_back([=](ErrorLogger &errorLogger) {
+                    errorLogger.reportErr(msg);
+                });
+        }
+
+        void reportMetric(const std::string &metric) override {
+            if (mErrorLogger)
+                mErrorLogger->reportMetric(metric);
+            else
+                mMessages.emplace_back([=](ErrorLogger &errorLogger) {
+                    errorLogger.reportMetric(metric);
+                });
+        }
+
+        void reportProgress(const std::string &filename, const char stage[], const std::size_t value) override {
+            // the progress of a deferred configuration is outdated once it is passed on
+            if (mErrorLogger)
+                mErrorLogger->reportProgress(filename, stage, value);
+        }
+
+        /** Pass on the kept messages and all further ones to @p errorLogger */
+        void forward(ErrorLogger &errorLogger) {
+            for (const auto &message : mMessages)
+                message(errorLogger);
+            mMessages.clear();
+            mErrorLogger = &errorLogger;
+        }
+
+    private:
+        ErrorLogger *mErrorLogger{};
+        std::vector<std::function<void(ErrorLogger&)>> mMessages;
+    };
+
+    /**
+     * The simplification of a single configuration. It is executed by the thread
+     * which claims it first - either the one checking the file or a scheduled one.
+     */
+    class ConfigTask {
+    public:
+        ConfigTask(TokenList&& tokenlist, std::string currentConfig, int fileIndex)
+            : mTokenizer(std::move(tokenlist), mLogger)
+            , mCurrentConfig(std::move(currentConfig))
+            , mFileIndex(fileIndex)
+        {}
+
+        Tokenizer &tokenizer() {
+            return mTokenizer;
+        }
+
+        const std::string &currentConfig() const {
+            return mCurrentConfig;
+        }
+
+        /** Simplify the tokens unless another thread does so already */
+        void run() {
+            if (!mClaimed.exchange(true))
+                simplify();
+        }
+
+        /**
+         * Make sure the tokens have been simplified and pass on the messages to @p errorLogger.
+         * Rethrows the exception of the simplification.
+         * @return true if the tokens have been simplified successfully
+         */
+        bool finish(ErrorLogger &errorLogger) {
+            if (!mClaimed.exchange(true)) {
+                // nothing needs to be deferred
+                mLogger.forward(errorLogger);
+                simplify();
+            } else {
+                std::unique_lock<std::mutex> l(mSync);
+                mCond.wait(l, [this] {
+                    return mDone;
+                });
+            }
+            mLogger.forward(errorLogger);
+            if (mException)
+                std::rethrow_exception(mException);
+            return mSimplified;
+        }
+
+    private:
+        void simplify() {
+            try {
+                if (mTokenizer.tokens())
+                    mSimplified = mTokenizer.simplifyTokens1(mCurrentConfig, mFileIndex);
+            } catch (...) {
+                mException = std::current_exception();
+            }
+            std::lock_guard<std::mutex> l(mSync);
+            mDone = true;
+            mCond.notify_all();
+        }
+
+        DeferredErrorLogger mLogger;
+        Tokenizer mTokenizer;
+        const std::string mCurrentConfig;
+        const int mFileIndex;
+        std::atomic<bool> mClaimed{false};
+        std::mutex mSync;
+        std::condition_variable mCond;
+        bool mDone{};
+        bool mSimplified{};
+        std::exception_ptr mException;
+    };
+}
+
+/** Hash of the preprocessed tokens including everything which is passed on to the tokenizer */
+static std::size_t calculatePreprocessedHash(const simplecpp::TokenList &tokens)
+{
+    std::string hashData;
+    for (const simplecpp::Token *tok = tokens.cfront(); tok; tok = tok->next) {
+        hashData += std::to_string(tok->location.fileIndex);
+        hashData += ':';
+        hashData += std::to_string(tok->location.line);
+        hashData += ':';
+        hashData += std::to_string(tok->location.col);
+        hashData += ' ';
+        hashData += tok->macro;
+        hashData += ' ';
+        hashData += tok->str();
+        hashData += '\n';
+    }
+    return (std::hash<std::string>{})(hashData);
 }
 
 static std::string cmdFileName(std::string f)
@@ -805,6 +960,11 @@ unsigned int CppCheck::checkBuffer(const FileWithDetails &file, const char* data
     return checkBuffer(file, "", 0, data, size);
 }
 
+void CppCheck::setScheduleTask(ScheduleTaskFn scheduleTask)
+{
+    mScheduleTask = std::move(scheduleTask);
+}
+
 unsigned int CppCheck::check(const FileSettings &fs)
 {
     // TODO: move to constructor when CppCheck no longer owns the settings
@@ -991,7 +1151,11 @@ unsigned int CppCheck::checkInternal(const FileWithDetails& file, const std::str
         if (preprocessor.reportOutput(outputList, true))
             return mLogger->exitcode();
 
-        if (!preprocessor.loadFiles(files))
+        bool loaded = false;
+        Timer::run("Preprocessor::loadFiles", mSettings.showtime, mTimerResults, [&]() {
+            loaded = preprocessor.loadFiles(files);
+        });
+        if (!loaded)
             return mLogger->exitcode();
 
         checkPlistOutput(file, files);
@@ -1085,9 +1249,109 @@ unsigned int CppCheck::checkInternal(const FileWithDetails& file, const std::str
                 filesDeleter.addFile(dumpFile);
         }
 
+        // The configurations are preprocessed one after another. Their simplification is handed to other
+        // threads via mScheduleTask unless it writes output which would then be in an arbitrary order.
+        const bool scheduleConfigs = mScheduleTask && !mSettings.checkConfiguration &&
+                                     !mSettings.debugnormal && !mSettings.debugSimplified && !mSettings.debugsymdb &&
+                                     !mSettings.debugast && !mSettings.debugvalueflow && !mSettings.debugtemplate
+#ifdef HAVE_RULES
+                                     && !hasRule("raw")
+#endif
+        ;
+
+        struct PendingConfig {
+            std::shared_ptr<ConfigTask> task;
+            LocationMacros locationMacros;
+            bool showConfig;
+            bool duplicate;
+            std::string preprocessorDump;
+        };
+        std::list<PendingConfig> pendingConfigs;
+        const std::size_t maxPendingConfigs = scheduleConfigs ? std::max(mSettings.jobs, 1U) : 1;
+
+        // Check the oldest pending configuration. This is done in the original order of the configurations so the
+        // results do not depend on the scheduling.
         std::set<unsigned long long> hashes;
+        std::set<std::size_t> preprocessedHashes;
+        auto checkPendingConfig = [&]() {
+            PendingConfig pendingConfig = std::move(pendingConfigs.front());
+            pendingConfigs.pop_front();
+            ConfigTask &task = *pendingConfig.task;
+            Tokenizer &tokenizer = task.tokenizer();
+            const std::string &currentConfig = task.currentConfig();
+            try {
+                // locations macros
+                mLogger->setLocationMacros(std::move(pendingConfig.locationMacros));
+
+                // If only errors are printed, print filename after the check
+                if (!mSettings.quiet && pendingConfig.showConfig) {
+                    std::string fixedpath = Path::toNativeSeparators(file.spath());
+                    mErrorLogger.reportOut("Checking " + fixedpath + ": " + currentConfig + "...", Color::FgGreen);
+                }
+
+                if (pendingConfig.duplicate) {
+                    // The inline suppressions have been marked already as the locations are the same
+                    if (mSettings.debugwarnings)
+                        purgedConfigurationMessage(file.spath(), currentConfig);
+                    return;
+                }
+
+                if (!tokenizer.tokens())
+                    return;
+
+                // skip rest of iteration if just checking configuration
+                if (mSettings.checkConfiguration)
+                    return;
+
+#ifdef HAVE_RULES
+                // Execute rules for "raw" code
+                executeRules("raw", tokenizer.list);
+#endif
+
+                // Simplify tokens into normal form, skip rest of iteration if failed
+                if (!task.finish(mErrorLogger))
+                    return;
+
+                // dump xml if --dump
+                if ((mSettings.dump || !mSettings.addons.empty()) && fdump.is_open()) {
+                    fdump << "<dump cfg=\"" << ErrorLogger::toxml(currentConfig) << "\">" << std::endl;
+                    fdump << "  <standards>" << std::endl;
+                    fdump << "    <c version=\"" << mSettings.standards.getC() << "\"/>" << std::endl;
+                    fdump << "    <cpp version=\"" << mSettings.standards.getCPP() << "\"/>" << std::endl;
+                    fdump << "  </standards>" << std::endl;
+                    fdump << getLibraryDumpData();
+                    fdump << pendingConfig.preprocessorDump;
+                    tokenizer.dump(fdump);
+                    fdump << "</dump>" << std::endl;
+                }
+
+                if (mSettings.inlineSuppressions) {
+                    // Need to call this even if the hash will skip this configuration
+                    mSuppressions.nomsg.markUnmatchedInlineSuppressionsAsChecked(tokenizer);
+                }
+
+                // Skip if we already met the same simplified token list
+                if (maxConfigs > 1) {
+                    const std::size_t hash = tokenizer.list.calculateHash();
+                    if (hashes.find(hash) != hashes.end()) {
+                        if (mSettings.debugwarnings)
+                            purgedConfigurationMessage(file.spath(), currentConfig);
+                        return;
+                    }
+                    hashes.insert(hash);
+                }
+
+                // Check normal tokens
+                checkNormalTokens(tokenizer, analyzerInformation.get(), currentConfig);
+            } catch (const InternalError &e) {
+                ErrorMessage errmsg = ErrorMessage::fromInternalError(e, &tokenizer.list, file.spath());
+                mErrorLogger.reportErr(errmsg);
+            }
+        };
+
         int checkCount = 0;
         bool hasValidConfig = false;
+        bool tooManyConfigs = false;
         std::list<std::string> configurationError;
         for (const std::string &currCfg : configurations) {
             // bail out if terminated
@@ -1102,9 +1366,7 @@ unsigned int CppCheck::checkInternal(const FileWithDetails& file, const std::str
                 // the information message is not reported, the whole purpose of setting i.e. --max-configs=1 is to
                 // skip configurations. When --check-config is used then tooManyConfigs will be reported even if the
                 // value is non-default.
-                if (!mSettings.isMaxConfigsAssigned() && mSettings.severity.isEnabled(Severity::information))
-                    tooManyConfigsError(Path::toNativeSeparators(file.spath()), configurations.size());
-
+                tooManyConfigs = !mSettings.isMaxConfigsAssigned() && mSettings.severity.isEnabled(Severity::information);
                 break;
             }
 
@@ -1144,6 +1406,7 @@ unsigned int CppCheck::checkInternal(const FileWithDetails& file, const std::str
             }
 
             TokenList tokenlist{mSettings, file.lang()};
+            bool duplicate = false;
 
             {
                 bool skipCfg = false;
@@ -1153,7 +1416,12 @@ unsigned int CppCheck::checkInternal(const FileWithDetails& file, const std::str
                     simplecpp::TokenList tokensP = preprocessor.preprocess(currentConfig, files, outputList_cfg);
                     const simplecpp::Output* o = preprocessor.handleErrors(outputList_cfg);
                     if (!o) {
-                        tokenlist.createTokens(std::move(tokensP));
+                        // Skip if we already met the same preprocessed tokens - the simplification would yield
+                        // the same result. The dump needs to contain every configuration though.
+                        if (maxConfigs > 1 && !fdump.is_open() && tokensP.cfront())
+                            duplicate = !preprocessedHashes.insert(calculatePreprocessedHash(tokensP)).second;
+                        if (!duplicate)
+                            tokenlist.createTokens(std::move(tokensP));
                     }
                     else {
                         // #error etc during preprocessing
@@ -1172,73 +1440,43 @@ unsigned int CppCheck::checkInternal(const FileWithDetails& file, const std::str
             }
             hasValidConfig = true;
 
-            Tokenizer tokenizer(std::move(tokenlist), mErrorLogger);
-            try {
-                if (mSettings.showtime != ShowTime::NONE)
-                    tokenizer.setTimerResults(mTimerResults);
-                tokenizer.setDirectives(directives); // TODO: how to avoid repeated copies?
-
-                // locations macros
-                mLogger->setLocationMacros(tokenizer.tokens(), files);
-
-                // If only errors are printed, print filename after the check
-                if (!mSettings.quiet && (!currentConfig.empty() || checkCount > 1)) {
-                    std::string fixedpath = Path::toNativeSeparators(file.spath());
-                    mErrorLogger.reportOut("Checking " + fixedpath + ": " + currentConfig + "...", Color::FgGreen);
-                }
-
-                if (!tokenizer.tokens())
-                    continue;
-
-                // skip rest of iteration if just checking configuration
-                if (mSettings.checkConfiguration)
-                    continue;
-
-#ifdef HAVE_RULES
-                // Execute rules for "raw" code
-                executeRules("raw", tokenizer.list);
-#endif
+            // the preprocessor only keeps the data of the latest configuration
+            std::string preprocessorDump;
+            if ((mSettings.dump || !mSettings.addons.empty()) && fdump.is_open()) {
+                std::ostringstream oss;
+                preprocessor.dump(oss);
+                preprocessorDump = oss.str();
+            }
 
-                // Simplify tokens into normal form, skip rest of iteration if failed
-                if (!tokenizer.simplifyTokens1(currentConfig, fileIndex))
-                    continue;
+            LocationMacros locationMacros = getLocationMacros(tokenlist.front(), files);
+            const bool hasTokens = tokenlist.front() != nullptr;
+            auto task = std::make_shared<ConfigTask>(std::move(tokenlist), currentConfig, fileIndex);
+            if (mSettings.showtime != ShowTime::NONE)
+                task->tokenizer().setTimerResults(mTimerResults);
+            task->tokenizer().setDirectives(directives); // TODO: how to avoid repeated copies?
+
+            if (scheduleConfigs && hasTokens) {
+                const std::weak_ptr<ConfigTask> weakTask = task;
+                mScheduleTask([weakTask]() {
+                    // the task has already been finished if it is gone
+                    if (const std::shared_ptr<ConfigTask> t = weakTask.lock())
+                        t->run();
+                });
+            }
 
-                // dump xml if --dump
-                if ((mSettings.dump || !mSettings.addons.empty()) && fdump.is_open()) {
-                    fdump << "<dump cfg=\"" << ErrorLogger::toxml(currentConfig) << "\">" << std::endl;
-                    fdump << "  <standards>" << std::endl;
-                    fdump << "    <c version=\"" << mSettings.standards.getC() << "\"/>" << std::endl;
-                    fdump << "    <cpp version=\"" << mSettings.standards.getCPP() << "\"/>" << std::endl;
-                    fdump << "  </standards>" << std::endl;
-                    fdump << getLibraryDumpData();
-                    preprocessor.dump(fdump);
-                    tokenizer.dump(fdump);
-                    fdump << "</dump>" << std::endl;
-                }
+            pendingConfigs.push_back({std::move(task), std::move(locationMacros), !currentConfig.empty() || checkCount > 1, duplicate, std::move(preprocessorDump)});
 
-                if (mSettings.inlineSuppressions) {
-                    // Need to call this even if the hash will skip this configuration
-                    mSuppressions.nomsg.markUnmatchedInlineSuppressionsAsChecked(tokenizer);
-                }
+            // only preprocess as far ahead as the configurations might be simplified in parallel
+            if (pendingConfigs.size() >= maxPendingConfigs)
+                checkPendingConfig();
+        }
 
-                // Skip if we already met the same simplified token list
-                if (maxConfigs > 1) {
-                    const std::size_t hash = tokenizer.list.calculateHash();
-                    if (hashes.find(hash) != hashes.end()) {
-                        if (mSettings.debugwarnings)
-                            purgedConfigurationMessage(file.spath(), currentConfig);
-                        continue;
-                    }
-                    hashes.insert(hash);
-                }
+        while (!pendingConfigs.empty() && !Settings::terminated())
+            checkPendingConfig();
 
-                // Check normal tokens
-                checkNormalTokens(tokenizer, analyzerInformation.get(), currentConfig);
-            } catch (const InternalError &e) {
-                ErrorMessage errmsg = ErrorMessage::fromInternalError(e, &tokenizer.list, file.spath());
-                mErrorLogger.reportErr(errmsg);
-            }
-        }
+        // reported after the checked configurations
+        if (tooManyConfigs && !Settings::terminated())
+            tooManyConfigsError(Path::toNativeSeparators(file.spath()), configurations.size());
 
         if (!hasValidConfig && configurations.size() > 1 && mSettings.severity.isEnabled(Severity::information)) {
             std::string msg;
@@ -64,6 +64,9 @@ public:
     // exe, args, redirect, output
     using ExecuteCmdFn = std::function<int (std::string,std::vector<std::string>,std::string,std::string&)>;
 
+    // task, returns false if the task was not accepted
+    using ScheduleTaskFn = std::function<bool (std::function<void()>)>;
+
     /**
      * @brief Constructor.
      */
@@ -110,6 +113,14 @@ public:
      */
     unsigned int checkBuffer(const FileWithDetails &file, const char* data, std::size_t size);
 
+    /**
+     * @brief Allow the configurations of a file to be simplified by other threads.
+     * The tasks might be executed at any time by any thread. If a task has not been
+     * started when its configuration is checked it is executed by the checking thread.
+     * @param scheduleTask Callback which hands over a task to another thread.
+     */
+    void setScheduleTask(ScheduleTaskFn scheduleTask);
+
     /**
      * @brief Returns current version number as a string.
      * @return version, e.g. "1.38"
@@ -253,6 +264,9 @@ private:
     /** Callback for executing a shell command (exe, args, output) */
     ExecuteCmdFn mExecuteCommand;
 
+    /** Callback for handing over the simplification of configurations to other threads */
+    ScheduleTaskFn mScheduleTask;
+
     std::unique_ptr<CheckUnusedFunctions> mUnusedFunctionsCheck;
 };
 
@@ -349,7 +349,7 @@ CTU::FileInfo *CTU::getFileInfo(const Tokenizer &tokenizer)
                     functionCall.callArgumentExpression = argtok->expressionString();
                     functionCall.callArgValue = value;
                     functionCall.warning = !value.errorSeverity();
-                    for (const ErrorPathItem &i : value.errorPath) {
+                    for (const ErrorPathItem &i : value.errorPath.toErrorPath()) {
                         const std::string& file = tokenizer.list.file(i.first);
                         const std::string& info = i.second;
                         const int line = i.first->linenr();
@@ -97,3 +97,35 @@ Severity severityFromString(const std::string& severity)
         return Severity::internal;
     return Severity::none;
 }
+
+SharedErrorPath::SharedErrorPath(const ErrorPath &errorPath)
+{
+    append(errorPath);
+}
+
+void SharedErrorPath::emplace_back(const Token *tok, std::string info)
+{
+    mLast = std::make_shared<const Node>(std::move(mLast), tok, std::move(info));
+}
+
+void SharedErrorPath::append(const SharedErrorPath &other)
+{
+    if (empty()) {
+        mLast = other.mLast;
+        return;
+    }
+    append(other.toErrorPath());
+}
+
+void SharedErrorPath::append(const ErrorPath &errorPath)
+{
+    for (const ErrorPathItem &e : errorPath)
+        emplace_back(e.first, e.second);
+}
+
+void SharedErrorPath::appendTo(ErrorPath &errorPath) const
+{
+    auto pos = errorPath.end();
+    for (const Node *node = mLast.get(); node; node = node->prev.get())
+        pos = errorPath.insert(pos, node->item);
+}
@@ -25,7 +25,9 @@
 
 #include <cstdint>
 #include <stdexcept>
+#include <cstddef>
 #include <list>
+#include <memory>
 #include <string>
 #include <utility>
 
@@ -130,6 +132,63 @@ struct CWE {
 using ErrorPathItem = std::pair<const Token *, std::string>;
 using ErrorPath = std::list<ErrorPathItem>;
 
+/**
+ * @brief Error path that shares its items with its copies.
+ *
+ * The items are kept in an immutable list that is linked from the last item to the
+ * first one. Copying a path and appending items to the copy never copies the existing
+ * items. This is used for the error paths of the ValueFlow values that are copied all
+ * the time but only rarely reported.
+ */
+class CPPCHECKLIB SharedErrorPath {
+public:
+    SharedErrorPath() = default;
+    // cppcheck-suppress noExplicitConstructor
+    SharedErrorPath(const ErrorPath &errorPath); // NOLINT(google-explicit-constructor)
+
+    bool empty() const {
+        return !mLast;
+    }
+
+    std::size_t size() const {
+        return mLast ? mLast->size : 0;
+    }
+
+    const ErrorPathItem &back() const {
+        return mLast->item;
+    }
+
+    void emplace_back(const Token *tok, std::string info);
+
+    /** Append the items of the given path */
+    void append(const SharedErrorPath &other);
+    void append(const ErrorPath &errorPath);
+
+    void clear() {
+        mLast.reset();
+    }
+
+    /** Append the items to the given error path */
+    void appendTo(ErrorPath &errorPath) const;
+
+    ErrorPath toErrorPath() const {
+        ErrorPath errorPath;
+        appendTo(errorPath);
+        return errorPath;
+    }
+
+private:
+    struct Node {
+        Node(std::shared_ptr<const Node> p, const Token *tok, std::string info)
+            : prev(std::move(p)), item(tok, std::move(info)), size(prev ? prev->size + 1 : 1) {}
+        std::shared_ptr<const Node> prev;
+        ErrorPathItem item;
+        std::size_t size;
+    };
+
+    std::shared_ptr<const Node> mLast;
+};
+
 /// @}
 //---------------------------------------------------------------------------
 #endif // errortypesH
@@ -27,7 +27,6 @@
 #include <cassert>
 #include <algorithm>
 #include <functional>
-#include <iterator>
 #include <unordered_set>
 #include <utility>
 
@@ -243,18 +242,14 @@ static void addToErrorPath(ValueFlow::Value& value, const std::vector<const Valu
     for (const ValueFlow::Value* ref : refs) {
         if (ref->condition && !value.condition)
             value.condition = ref->condition;
-        std::copy_if(ref->errorPath.cbegin(),
-                     ref->errorPath.cend(),
-                     std::back_inserter(value.errorPath),
-                     [&](const ErrorPathItem& e) {
-            return locations.insert(e.first).second;
-        });
-        std::copy_if(ref->debugPath.cbegin(),
-                     ref->debugPath.cend(),
-                     std::back_inserter(value.debugPath),
-                     [&](const ErrorPathItem& e) {
-            return locations.insert(e.first).second;
-        });
+        for (const ErrorPathItem& e : ref->errorPath.toErrorPath()) {
+            if (locations.insert(e.first).second)
+                value.errorPath.emplace_back(e.first, e.second);
+        }
+        for (const ErrorPathItem& e : ref->debugPath()) {
+            if (locations.insert(e.first).second)
+                value.addDebugPath(e.first, e.second);
+        }
     }
 }
 
@@ -1401,10 +1401,15 @@ const Library::Container* Library::detectContainerInternal(const Token* const ty
             continue;
 
         const int offset = (withoutStd && startsWith(container.startPattern2, "std :: ")) ? 7 : 0;
+        auto matchStartPattern = [&]() {
+            if (offset == 0)
+                return Token::Match(typeStart, container.startPattern2);
+            return Token::Match(typeStart, container.startPattern2.c_str() + offset);
+        };
 
         // If endPattern is undefined, it will always match, but itEndPattern has to be defined.
         if (detect != IteratorOnly && container.endPattern.empty()) {
-            if (!Token::Match(typeStart, container.startPattern2.c_str() + offset))
+            if (!matchStartPattern())
                 continue;
 
             if (isIterator)
@@ -1415,16 +1420,16 @@ const Library::Container* Library::detectContainerInternal(const Token* const ty
         if (!firstLinkedTok)
             continue;
 
-        const bool matchedStartPattern = Token::Match(typeStart, container.startPattern2.c_str() + offset);
+        const bool matchedStartPattern = matchStartPattern();
         if (!matchedStartPattern)
             continue;
 
-        if (detect != ContainerOnly && Token::Match(firstLinkedTok->link(), container.itEndPattern.c_str())) {
+        if (detect != ContainerOnly && Token::Match(firstLinkedTok->link(), container.itEndPattern)) {
             if (isIterator)
                 *isIterator = true;
             return &container;
         }
-        if (detect != IteratorOnly && Token::Match(firstLinkedTok->link(), container.endPattern.c_str())) {
+        if (detect != IteratorOnly && Token::Match(firstLinkedTok->link(), container.endPattern)) {
             if (isIterator)
                 *isIterator = false;
             return &container;
@@ -30,13 +30,21 @@
 #include "utils.h"
 
 #include <algorithm>
-#include <array>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <sstream>
+#include <thread>
+#include <unordered_set>
 #include <utility>
 
 #include <simplecpp.h>
@@ -375,7 +383,7 @@ std::list<Directive> Preprocessor::createDirectives() const
     return directives;
 }
 
-static std::string readcondition(const simplecpp::Token *iftok, const std::set<std::string> &defined, const std::set<std::string> &undefined)
+static std::string readcondition(const simplecpp::Token *iftok, const std::unordered_set<std::string> &defined, const std::set<std::string> &undefined)
 {
     const simplecpp::Token *cond = iftok->next;
     if (!sameline(iftok,cond))
@@ -468,17 +476,17 @@ static std::string readcondition(const simplecpp::Token *iftok, const std::set<s
 
 static bool hasDefine(const std::string &userDefines, const std::string &cfg)
 {
-    if (cfg.empty()) {
+    if (cfg.empty() || userDefines.empty()) {
         return false;
     }
 
     std::string::size_type pos = 0;
-    const std::string cfgname = cfg.substr(0, cfg.find('='));
+    const std::string::size_type cfgnameLen = std::min(cfg.find('='), cfg.size());
     while (pos < userDefines.size()) {
-        pos = userDefines.find(cfgname, pos);
+        pos = userDefines.find(cfg.c_str(), pos, cfgnameLen);
         if (pos == std::string::npos)
             break;
-        const std::string::size_type pos2 = pos + cfgname.size();
+        const std::string::size_type pos2 = pos + cfgnameLen;
         if ((pos == 0 || userDefines[pos-1U] == ';') && (pos2 == userDefines.size() || userDefines[pos2] == '='))
             return true;
         pos = pos2;
@@ -488,24 +496,37 @@ static bool hasDefine(const std::string &userDefines, const std::string &cfg)
 
 static std::string cfg(const std::vector<std::string> &configs, const std::string &userDefines)
 {
-    std::set<std::string> configs2(configs.cbegin(), configs.cend());
-    std::string ret;
-    for (const std::string &c : configs2) {
-        if (c.empty())
-            continue;
+    // sorted without duplicates - without copying the strings
+    std::vector<const std::string *> configs2;
+    configs2.reserve(configs.size());
+    for (const std::string &c : configs) {
         if (c == "0")
             return "";
-        if (hasDefine(userDefines, c))
+        if (!c.empty())
+            configs2.push_back(&c);
+    }
+    std::sort(configs2.begin(), configs2.end(), [](const std::string *c1, const std::string *c2) {
+        return *c1 < *c2;
+    });
+    configs2.erase(std::unique(configs2.begin(), configs2.end(), [](const std::string *c1, const std::string *c2) {
+        return *c1 == *c2;
+    }), configs2.end());
+
+    std::string ret;
+    for (const std::string *c : configs2) {
+        if (hasDefine(userDefines, *c))
             continue;
         if (!ret.empty())
             ret += ';';
-        ret += c;
+        ret += *c;
     }
     return ret;
 }
 
 static bool isUndefined(const std::string &cfg, const std::set<std::string> &undefined)
 {
+    if (undefined.empty())
+        return false;
     for (std::string::size_type pos1 = 0U; pos1 < cfg.size();) {
         const std::string::size_type pos2 = cfg.find(';',pos1);
         const std::string def = (pos2 == std::string::npos) ? cfg.substr(pos1) : cfg.substr(pos1, pos2 - pos1);
@@ -546,7 +567,7 @@ static const simplecpp::Token *gotoEndIf(const simplecpp::Token *cmdtok)
     return nullptr;
 }
 
-static void getConfigs(const simplecpp::TokenList &tokens, std::set<std::string> &defined, const std::string &userDefines, const std::set<std::string> &undefined, std::set<std::string> &ret)
+static void getConfigs(const simplecpp::TokenList &tokens, std::unordered_set<std::string> &defined, const std::string &userDefines, const std::set<std::string> &undefined, std::unordered_set<std::string> &ret)
 {
     std::vector<std::string> configs_if;
     std::vector<std::string> configs_ifndef;
@@ -581,15 +602,17 @@ static void getConfigs(const simplecpp::TokenList &tokens, std::set<std::string>
             if (cmdtok->str() == "ifndef")
                 ifndef = true;
             else {
-                const std::array<std::string, 6> match{"if", "!", "defined", "(", config, ")"};
-                std::size_t i = 0;
-                ifndef = true;
-                for (const simplecpp::Token *t = cmdtok; i < match.size(); t = t->next) {
-                    if (!t || t->str() != match[i++]) {
-                        ifndef = false;
+                // #if !defined(config)
+                static const char * const match[] = {"if", "!", "defined", "("};
+                const simplecpp::Token *t = cmdtok;
+                for (const char *m : match) {
+                    if (!t || t->str() != m) {
+                        t = nullptr;
                         break;
                     }
+                    t = t->next;
                 }
+                ifndef = t && t->str() == config && t->next && t->next->str() == ")";
             }
 
             // include guard..
@@ -613,7 +636,7 @@ static void getConfigs(const simplecpp::TokenList &tokens, std::set<std::string>
             {
                 const std::string::size_type eq = config.find('=');
                 const std::string config2 = (eq != std::string::npos) ? config.substr(0, eq) : config + "=" + config;
-                const std::set<std::string>::iterator it2 = ret.find(config2);
+                const std::unordered_set<std::string>::iterator it2 = ret.find(config2);
                 if (it2 != ret.end()) {
                     if (eq == std::string::npos) {
                         // The instance in ret is more specific than the one in config (no =value), replace it with the one in config
@@ -663,7 +686,7 @@ static void getConfigs(const simplecpp::TokenList &tokens, std::set<std::string>
                 const std::string &confCandidate = configs_ifndef.back();
                 if (ret.find(confCandidate) == ret.end()) {
                     // No instance of config_ifndef in ret. Check if a more specific version exists, in that case replace it
-                    const std::set<std::string>::iterator it = ret.find(confCandidate + "=" + confCandidate);
+                    const std::unordered_set<std::string>::iterator it = ret.find(confCandidate + "=" + confCandidate);
                     if (it != ret.end()) {
                         // The instance in ret is more specific than the one in confCandidate (no =value), replace it with the one in confCandidate
                         ret.erase(it);
@@ -684,7 +707,7 @@ static void getConfigs(const simplecpp::TokenList &tokens, std::set<std::string>
                 std::vector<std::string> configs(configs_if);
                 configs.push_back(configs_ifndef.back());
                 ret.erase(cfg(configs, userDefines));
-                std::set<std::string> temp;
+                std::unordered_set<std::string> temp;
                 temp.swap(ret);
                 for (const std::string &c: temp) {
                     if (c.find(configs_ifndef.back()) != std::string::npos)
@@ -722,11 +745,14 @@ static void getConfigs(const simplecpp::TokenList &tokens, std::set<std::string>
 
 std::set<std::string> Preprocessor::getConfigs() const
 {
-    std::set<std::string> ret = { "" };
     if (!mTokens.cfront())
-        return ret;
+        return { "" };
 
-    std::set<std::string> defined = { "__cplusplus" };
+    // The configurations are collected in a hash set since every directive
+    // looks up and inserts into it; they are only sorted once at the end.
+    std::unordered_set<std::string> ret = { "" };
+
+    std::unordered_set<std::string> defined = { "__cplusplus" };
 
     // Insert library defines
     for (const auto &define : mSettings.library.defines()) {
@@ -748,7 +774,7 @@ std::set<std::string> Preprocessor::getConfigs() const
             ::getConfigs(filedata->tokens, defined, mSettings.userDefines, mSettings.userUndefs, ret);
     }
 
-    return ret;
+    return std::set<std::string>(ret.cbegin(), ret.cend());
 }
 
 static void splitcfg(const std::string &cfg, std::list<std::string> &defines, const std::string &defaultValue)
@@ -816,12 +842,368 @@ const simplecpp::Output* Preprocessor::handleErrors(const simplecpp::OutputList&
     return reportOutput(outputList, showerror);
 }
 
+namespace {
+    /** Serialization of the cached header tokens in the build dir */
+    class RawTokensWriter {
+    public:
+        explicit RawTokensWriter(std::string &out) : mOut(out) {}
+
+        template<class T>
+        void write(T value) {
+            char buf[sizeof(T)];
+            std::memcpy(buf, &value, sizeof(T));
+            mOut.append(buf, sizeof(T));
+        }
+        void write(const std::string &str) {
+            write(static_cast<std::uint32_t>(str.size()));
+            mOut += str;
+        }
+        void write(const simplecpp::Location &location) {
+            write<std::uint32_t>(location.fileIndex);
+            write<std::uint32_t>(location.line);
+            write<std::uint32_t>(location.col);
+        }
+
+    private:
+        std::string &mOut;
+    };
+
+    class RawTokensReader {
+    public:
+        RawTokensReader(const std::string &in, std::size_t pos) : mIn(in), mPos(pos) {}
+
+        template<class T>
+        bool read(T &value) {
+            if (mIn.size() - mPos < sizeof(T))
+                return false;
+            std::memcpy(&value, mIn.data() + mPos, sizeof(T));
+            mPos += sizeof(T);
+            return true;
+        }
+        bool read(std::string &str) {
+            std::uint32_t size;
+            if (!read(size) || mIn.size() - mPos < size)
+                return false;
+            str.assign(mIn, mPos, size);
+            mPos += size;
+            return true;
+        }
+        bool read(simplecpp::Location &location) {
+            std::uint32_t fileIndex, line, col;
+            if (!read(fileIndex) || !read(line) || !read(col))
+                return false;
+            location = simplecpp::Location(fileIndex, line, col);
+            return true;
+        }
+        bool atEnd() const {
+            return mPos == mIn.size();
+        }
+
+    private:
+        const std::string &mIn;
+        std::size_t mPos;
+    };
+
+    const char rawTokensMagic[] = "cppcheck raw tokens 1\n";
+    const std::uint32_t rawTokensByteOrder = 0x01020304;
+
+    enum : std::uint8_t {
+        fName = (1 << 0),
+        fNumber = (1 << 1),
+        fComment = (1 << 2),
+        fWhitespaceAhead = (1 << 3)
+    };
+}
+
+struct HeaderCache::Entry {
+    Entry(std::size_t hash, std::size_t length)
+        : tokens(files)
+        , hash(hash)
+        , length(length)
+    {}
+
+    void tokenize(const std::string &path, const std::string &data) {
+        tokens = simplecpp::TokenList(simplecpp::View(data), files, path, &output);
+    }
+
+    void calculateSize() {
+        size = 0;
+        for (const simplecpp::Token *tok = tokens.cfront(); tok; tok = tok->next)
+            size += sizeof(simplecpp::Token) + tok->str().capacity();
+    }
+
+    std::string serialize() const;
+    bool deserialize(const std::string &in, const std::string &path);
+
+    std::vector<std::string> files;
+    simplecpp::OutputList output;
+    simplecpp::TokenList tokens;
+    std::size_t hash;
+    std::size_t length;
+    std::size_t size{};
+};
+
+std::string HeaderCache::Entry::serialize() const
+{
+    std::string out(rawTokensMagic);
+    RawTokensWriter writer(out);
+    writer.write(rawTokensByteOrder);
+    writer.write<std::uint64_t>(hash);
+    writer.write<std::uint64_t>(length);
+    writer.write(static_cast<std::uint32_t>(files.size()));
+    for (const std::string &file : files)
+        writer.write(file);
+    writer.write(static_cast<std::uint32_t>(output.size()));
+    for (const simplecpp::Output &o : output) {
+        writer.write(static_cast<std::uint8_t>(o.type));
+        writer.write(o.location);
+        writer.write(o.msg);
+    }
+    std::uint32_t count = 0;
+    for (const simplecpp::Token *tok = tokens.cfront(); tok; tok = tok->next)
+        ++count;
+    writer.write(count);
+    for (const simplecpp::Token *tok = tokens.cfront(); tok; tok = tok->next) {
+        writer.write(tok->str());
+        writer.write(tok->location);
+        writer.write(static_cast<std::uint8_t>((tok->name ? fName : 0) |
+                                               (tok->number ? fNumber : 0) |
+                                               (tok->comment ? fComment : 0) |
+                                               (tok->whitespaceahead ? fWhitespaceAhead : 0)));
+        writer.write(tok->op);
+    }
+    return out;
+}
+
+bool HeaderCache::Entry::deserialize(const std::string &in, const std::string &path)
+{
+    const std::size_t magicSize = sizeof(rawTokensMagic) - 1;
+    if (in.compare(0, magicSize, rawTokensMagic, magicSize) != 0)
+        return false;
+    RawTokensReader reader(in, magicSize);
+
+    std::uint32_t byteOrder;
+    std::uint64_t fileHash, fileLength;
+    if (!reader.read(byteOrder) || byteOrder != rawTokensByteOrder ||
+        !reader.read(fileHash) || fileHash != hash ||
+        !reader.read(fileLength) || fileLength != length)
+        return false;
+
+    std::uint32_t count;
+    if (!reader.read(count) || count == 0)
+        return false;
+    files.resize(count);
+    for (std::string &file : files) {
+        if (!reader.read(file))
+            return false;
+    }
+    if (files[0] != path)
+        return false;
+
+    if (!reader.read(count))
+        return false;
+    for (std::uint32_t i = 0; i < count; ++i) {
+        std::uint8_t type;
+        simplecpp::Location location;
+        std::string msg;
+        if (!reader.read(type) || !reader.read(location) || location.fileIndex >= files.size() || !reader.read(msg))
+            return false;
+        output.push_back({static_cast<simplecpp::Output::Type>(type), location, std::move(msg)});
+    }
+
+    if (!reader.read(count))
+        return false;
+    for (std::uint32_t i = 0; i < count; ++i) {
+        std::string str;
+        simplecpp::Location location;
+        std::uint8_t flags;
+        char op;
+        if (!reader.read(str) || str.empty() || !reader.read(location) || location.fileIndex >= files.size() ||
+            !reader.read(flags) || !reader.read(op))
+            return false;
+        auto *const tok = new simplecpp::Token(str, location, (flags & fWhitespaceAhead) != 0);
+        tok->name = (flags & fName) != 0;
+        tok->number = (flags & fNumber) != 0;
+        tok->comment = (flags & fComment) != 0;
+        tok->op = op;
+        tokens.push_back(tok);
+    }
+    return reader.atEnd();
+}
+
+HeaderCache &HeaderCache::instance()
+{
+    static HeaderCache cache(0);
+    return cache;
+}
+
+void HeaderCache::setMaxSize(std::size_t maxSize)
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    mMaxSize = maxSize;
+    evict();
+}
+
+std::size_t HeaderCache::count() const
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    return mEntries.size();
+}
+
+std::size_t HeaderCache::size() const
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    return mSize;
+}
+
+void HeaderCache::remove(Entries::iterator it)
+{
+    mSize -= it->second->size;
+    mPaths.erase(it->first);
+    mEntries.erase(it);
+}
+
+void HeaderCache::evict()
+{
+    while (mSize > mMaxSize)
+        remove(std::prev(mEntries.end()));
+}
+
+static bool readFile(const std::string &path, std::string &data)
+{
+    std::ifstream fin(path, std::ios::in | std::ios::binary);
+    if (!fin.is_open())
+        return false;
+    fin.seekg(0, std::ios::end);
+    const std::streamoff length = fin.tellg();
+    if (length < 0)
+        return false;
+    data.resize(static_cast<std::size_t>(length));
+    fin.seekg(0, std::ios::beg);
+    return fin.read(&data[0], length).gcount() == length;
+}
+
+static void writeCacheFile(const std::string &filename, const std::string &data)
+{
+    // write a temporary file first so other processes never read a partially written file
+    const std::size_t unique = std::hash<std::thread::id>{}(std::this_thread::get_id()) ^
+                               static_cast<std::size_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    const std::string tempFile = filename + "." + std::to_string(unique) + ".tmp";
+    {
+        std::ofstream fout(tempFile, std::ios::out | std::ios::binary);
+        if (!fout.is_open())
+            return;
+        fout.write(data.data(), data.size());
+        if (!fout.good()) {
+            fout.close();
+            std::remove(tempFile.c_str());
+            return;
+        }
+    }
+    if (std::rename(tempFile.c_str(), filename.c_str()) != 0)
+        std::remove(tempFile.c_str());
+}
+
+void HeaderCache::setBuildDir(std::string buildDir)
+{
+    std::lock_guard<std::mutex> lg(mMutex);
+    mBuildDir = std::move(buildDir);
+}
+
+std::string HeaderCache::getCacheFile(const std::string &buildDir, const std::string &path)
+{
+    std::ostringstream ostr;
+    ostr << Path::stripDirectoryPart(path) << '.' << std::hex << std::hash<std::string>{}(path) << ".rawtokens";
+    return Path::join(buildDir, ostr.str());
+}
+
+simplecpp::TokenList HeaderCache::load(const std::string &path, std::vector<std::string> &filenames, simplecpp::OutputList *outputList)
+{
+    std::string data;
+    if (!readFile(path, data))
+        return simplecpp::TokenList(path, filenames, outputList);
+    const std::size_t hash = std::hash<std::string>{}(data);
+
+    std::shared_ptr<const Entry> entry;
+    std::string buildDir;
+    {
+        std::lock_guard<std::mutex> lg(mMutex);
+        buildDir = mBuildDir;
+        const auto it = mPaths.find(path);
+        if (it != mPaths.end()) {
+            if (it->second->second->hash == hash && it->second->second->length == data.size()) {
+                mEntries.splice(mEntries.begin(), mEntries, it->second);
+                entry = it->second->second;
+            } else {
+                remove(it->second);
+            }
+        }
+    }
+
+    if (!entry) {
+        // tokenize outside of the lock, another thread might do the same meanwhile
+        auto newEntry = std::make_shared<Entry>(hash, data.size());
+        const std::string cacheFile = buildDir.empty() ? std::string() : getCacheFile(buildDir, path);
+        std::string cached;
+        if (cacheFile.empty() || !readFile(cacheFile, cached) || !newEntry->deserialize(cached, path)) {
+            newEntry = std::make_shared<Entry>(hash, data.size());
+            newEntry->tokenize(path, data);
+            if (!cacheFile.empty())
+                writeCacheFile(cacheFile, newEntry->serialize());
+        }
+        newEntry->calculateSize();
+        entry = std::move(newEntry);
+
+        std::lock_guard<std::mutex> lg(mMutex);
+        if (entry->size <= mMaxSize && mPaths.find(path) == mPaths.end()) {
+            mEntries.emplace_front(path, entry);
+            mPaths.emplace(path, mEntries.begin());
+            mSize += entry->size;
+            evict();
+        }
+    }
+
+    // the file indexes of the cached tokens refer to the file names of the cached header
+    std::vector<unsigned int> fileIndexes;
+    fileIndexes.reserve(entry->files.size());
+    for (const std::string &file : entry->files) {
+        const auto it = std::find(filenames.cbegin(), filenames.cend(), file);
+        fileIndexes.push_back(static_cast<unsigned int>(it - filenames.cbegin()));
+        if (it == filenames.cend())
+            filenames.push_back(file);
+    }
+
+    simplecpp::TokenList tokens(filenames);
+    for (const simplecpp::Token *tok = entry->tokens.cfront(); tok; tok = tok->next) {
+        auto *const copy = new simplecpp::Token(*tok);
+        copy->location.fileIndex = fileIndexes[tok->location.fileIndex];
+        tokens.push_back(copy);
+    }
+    if (outputList) {
+        for (simplecpp::Output output : entry->output) {
+            output.location.fileIndex = fileIndexes[output.location.fileIndex];
+            outputList->push_back(std::move(output));
+        }
+    }
+    return tokens;
+}
+
 bool Preprocessor::loadFiles(std::vector<std::string> &files)
 {
     const simplecpp::DUI dui = createDUI(mSettings, "", mLang);
 
+    simplecpp::FileDataCache cache;
+    if (mSettings.headerCacheSize > 0 || !mSettings.buildDir.empty()) {
+        HeaderCache &headerCache = HeaderCache::instance();
+        headerCache.setMaxSize(static_cast<std::size_t>(mSettings.headerCacheSize) * 1024 * 1024);
+        headerCache.setBuildDir(mSettings.buildDir);
+        cache.setLoader([&headerCache](const std::string &path, std::vector<std::string> &filenames, simplecpp::OutputList *outputList) {
+            return headerCache.load(path, filenames, outputList);
+        });
+    }
+
     simplecpp::OutputList outputList;
-    mFileCache = simplecpp::load(mTokens, files, dui, &outputList);
+    mFileCache = simplecpp::load(mTokens, files, dui, &outputList, std::move(cache));
     return !handleErrors(outputList);
 }
 
@@ -853,6 +1235,9 @@ void Preprocessor::setPlatformInfo()
     mTokens.sizeOfType["long double *"] = mSettings.platform.sizeof_pointer;
 }
 
+/** The macro state after the forced includes (--include) is shared by the files with the same configuration */
+static simplecpp::MacroStateCache macroStateCache;
+
 simplecpp::TokenList Preprocessor::preprocess(const std::string &cfg, std::vector<std::string> &files, simplecpp::OutputList& outputList)
 {
     const simplecpp::DUI dui = createDUI(mSettings, cfg, mLang);
@@ -860,7 +1245,7 @@ simplecpp::TokenList Preprocessor::preprocess(const std::string &cfg, std::vecto
     std::list<simplecpp::MacroUsage> macroUsage;
     std::list<simplecpp::IfCond> ifCond;
     simplecpp::TokenList tokens2(files);
-    simplecpp::preprocess(tokens2, mTokens, files, mFileCache, dui, &outputList, &macroUsage, &ifCond);
+    simplecpp::preprocess(tokens2, mTokens, files, mFileCache, dui, &outputList, &macroUsage, &ifCond, &mMacroExpansionStats, &macroStateCache);
     mMacroUsage = std::move(macroUsage);
     mIfCond = std::move(ifCond);
 
@@ -28,8 +28,11 @@
 #include <cstdint>
 #include <istream>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -92,6 +95,66 @@ public:
 /// @addtogroup Core
 /// @{
 
+/**
+ * @brief Raw tokens of header files shared by the preprocessors of all files.
+ *
+ * The cache is keyed by the path and the content of the header, so a header is read
+ * again when it has been changed. The least recently used headers are dropped when
+ * the cached tokens take more memory than the limit. With a build dir the tokens are
+ * also stored on disk and loaded from there instead of tokenizing the header.
+ */
+class CPPCHECKLIB HeaderCache {
+public:
+    explicit HeaderCache(std::size_t maxSize) : mMaxSize(maxSize) {}
+
+    HeaderCache(const HeaderCache &) = delete;
+    HeaderCache &operator=(const HeaderCache &) = delete;
+
+    /** @return the cache that is shared by all preprocessors of the process */
+    static HeaderCache &instance();
+
+    /** set the memory limit in bytes */
+    void setMaxSize(std::size_t maxSize);
+
+    /**
+     * Set the build dir where the tokens of the headers are stored, so they don't need to be
+     * tokenized again by other processes or later runs. Empty disables storing the tokens.
+     */
+    void setBuildDir(std::string buildDir);
+
+    /** @return file in the build dir where the tokens of the given header are stored */
+    static std::string getCacheFile(const std::string &buildDir, const std::string &path);
+
+    /**
+     * Tokenize the given file, the tokens are copied from the cache if the file is unchanged.
+     * @param path        the file to read
+     * @param filenames   file names of the created token list
+     * @param outputList  messages from reading the file
+     */
+    simplecpp::TokenList load(const std::string &path, std::vector<std::string> &filenames, simplecpp::OutputList *outputList);
+
+    /** @return number of cached headers */
+    std::size_t count() const;
+
+    /** @return memory used by the cached headers in bytes */
+    std::size_t size() const;
+
+private:
+    struct Entry;
+    using Entries = std::list<std::pair<std::string, std::shared_ptr<const Entry>>>;
+
+    void remove(Entries::iterator it);
+    void evict();
+
+    mutable std::mutex mMutex;
+    std::size_t mMaxSize;
+    std::size_t mSize{};
+    std::string mBuildDir;
+    /** most recently used header first */
+    Entries mEntries;
+    std::unordered_map<std::string, Entries::iterator> mPaths;
+};
+
 /**
  * @brief The cppcheck preprocessor.
  * The preprocessor has special functionality for extracting the various ifdef
@@ -122,6 +185,11 @@ public:
 
     std::string getcode(const std::string &cfg, std::vector<std::string> &files, bool writeLocations);
 
+    /** counters of the macro expansion cache for all the configurations preprocessed so far */
+    const simplecpp::MacroExpansionStats &getMacroExpansionStats() const {
+        return mMacroExpansionStats;
+    }
+
     /**
      * Calculate HASH. Using toolinfo, tokens1, filedata.
      *
@@ -178,6 +246,7 @@ private:
     /** simplecpp tracking info */
     std::list<simplecpp::MacroUsage> mMacroUsage;
     std::list<simplecpp::IfCond> mIfCond;
+    simplecpp::MacroExpansionStats mMacroExpansionStats;
 };
 
 /// @}
@@ -33,8 +33,10 @@
 #include "valueptr.h"
 
 #include <algorithm>
+#include <bitset>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <functional>
 #include <iterator>
 #include <list>
@@ -63,12 +65,157 @@ std::size_t ExprIdToken::Hash::operator()(ExprIdToken etok) const
     return std::hash<nonneg int>()(etok.getExpressionId());
 }
 
+struct ProgramMemory::Entry {
+    std::shared_ptr<Node> child;
+    std::shared_ptr<value_type> leaf;
+};
+
+struct ProgramMemory::Node {
+    /** used slots */
+    std::uint32_t bitmap{};
+    /** one entry for each used slot, ordered by slot */
+    std::vector<Entry> entries;
+};
+
+static constexpr int PROGRAM_MEMORY_BITS = 5;
+
+static int programMemorySlot(nonneg int exprid, int level)
+{
+    return static_cast<int>((static_cast<unsigned int>(exprid) >> (level * PROGRAM_MEMORY_BITS)) & 31U);
+}
+
+static std::size_t programMemoryPosition(std::uint32_t bitmap, int slot)
+{
+    return std::bitset<32>(bitmap & ((1U << slot) - 1U)).count();
+}
+
+// Nodes and values that are shared with another ProgramMemory are copied before they are modified
+template<class T>
+static T& unshare(std::shared_ptr<T>& p)
+{
+    if (p.use_count() > 1)
+        p = std::make_shared<T>(*p);
+    return *p;
+}
+
+ProgramMemory::const_iterator::const_iterator(const Node* root)
+{
+    if (!root)
+        return;
+    mLevel = 0;
+    mNodes[0] = root;
+    mIndex[0] = -1;
+    next();
+}
+
+void ProgramMemory::const_iterator::next()
+{
+    while (mLevel >= 0) {
+        const Node* node = mNodes[mLevel];
+        const int i = ++mIndex[mLevel];
+        if (i >= static_cast<int>(node->entries.size())) {
+            --mLevel;
+            continue;
+        }
+        const Entry& e = node->entries[i];
+        if (e.child) {
+            ++mLevel;
+            mNodes[mLevel] = e.child.get();
+            mIndex[mLevel] = -1;
+            continue;
+        }
+        mLeaf = e.leaf.get();
+        return;
+    }
+    mLeaf = nullptr;
+}
+
+ProgramMemory::ProgramMemory(const Map& values)
+{
+    for (const auto& p : values)
+        insert(std::make_shared<value_type>(p));
+}
+
+const ProgramMemory::value_type* ProgramMemory::find(nonneg int exprid) const
+{
+    const Node* node = mRoot.get();
+    for (int level = 0; node; ++level) {
+        const int slot = programMemorySlot(exprid, level);
+        if (!(node->bitmap & (1U << slot)))
+            return nullptr;
+        const Entry& e = node->entries[programMemoryPosition(node->bitmap, slot)];
+        if (!e.child)
+            return e.leaf->first.getExpressionId() == exprid ? e.leaf.get() : nullptr;
+        node = e.child.get();
+    }
+    return nullptr;
+}
+
+ProgramMemory::Entry& ProgramMemory::findEntry(nonneg int exprid)
+{
+    if (!mRoot)
+        mRoot = std::make_shared<Node>();
+    std::shared_ptr<Node>* node = &mRoot;
+    for (int level = 0;; ++level) {
+        Node& n = unshare(*node);
+        const int slot = programMemorySlot(exprid, level);
+        const std::size_t pos = programMemoryPosition(n.bitmap, slot);
+        if (!(n.bitmap & (1U << slot))) {
+            n.bitmap |= 1U << slot;
+            return *n.entries.emplace(n.entries.begin() + pos);
+        }
+        Entry& e = n.entries[pos];
+        if (!e.child) {
+            if (e.leaf->first.getExpressionId() == exprid)
+                return e;
+            // move the other value one level down
+            assert(level + 1 < Depth);
+            e.child = std::make_shared<Node>();
+            e.child->bitmap = 1U << programMemorySlot(e.leaf->first.getExpressionId(), level + 1);
+            e.child->entries.resize(1);
+            e.child->entries[0].leaf = std::move(e.leaf);
+        }
+        node = &e.child;
+    }
+}
+
+ValueFlow::Value& ProgramMemory::get(const ExprIdToken& expr)
+{
+    Entry& e = findEntry(expr.getExpressionId());
+    if (!e.leaf) {
+        e.leaf = std::make_shared<value_type>(expr, ValueFlow::Value{});
+        ++mSize;
+        return e.leaf->second;
+    }
+    return unshare(e.leaf).second;
+}
+
+void ProgramMemory::insert(std::shared_ptr<value_type> leaf)
+{
+    Entry& e = findEntry(leaf->first.getExpressionId());
+    if (!e.leaf)
+        ++mSize;
+    e.leaf = std::move(leaf);
+}
+
+bool ProgramMemory::erase(std::shared_ptr<Node>& node, nonneg int exprid, int level)
+{
+    Node& n = unshare(node);
+    const int slot = programMemorySlot(exprid, level);
+    const std::size_t pos = programMemoryPosition(n.bitmap, slot);
+    Entry& e = n.entries[pos];
+    if (e.child && !erase(e.child, exprid, level + 1))
+        return false;
+    n.bitmap &= ~(1U << slot);
+    n.entries.erase(n.entries.begin() + pos);
+    // return true if the node is empty now
+    return n.entries.empty();
+}
+
 void ProgramMemory::setValue(const Token* expr, const ValueFlow::Value& value) {
     if (!expr)
         return;
 
-    copyOnWrite();
-
     ValueFlow::Value subvalue = value;
     const Token* subexpr = solveExprValue(
         expr,
@@ -82,17 +229,17 @@ void ProgramMemory::setValue(const Token* expr, const ValueFlow::Value& value) {
     },
         subvalue);
     if (expr != subexpr)
-        (*mValues)[expr] = value;
+        get(expr) = value;
     if (subexpr)
-        (*mValues)[subexpr] = std::move(subvalue);
+        get(subexpr) = std::move(subvalue);
 }
 
 const ValueFlow::Value* ProgramMemory::getValue(nonneg int exprid, bool impossible) const
 {
-    const auto it = find(exprid);
-    const bool found = it != mValues->cend() && (impossible || !it->second.isImpossible());
+    const value_type* p = find(exprid);
+    const bool found = p && (impossible || !p->second.isImpossible());
     if (found)
-        return &it->second;
+        return &p->second;
     return nullptr;
 }
 
@@ -160,69 +307,53 @@ void ProgramMemory::setContainerSizeValue(const Token* expr, MathLib::bigint val
 }
 
 void ProgramMemory::setUnknown(const Token* expr) {
-    copyOnWrite();
-
-    (*mValues)[expr].valueType = ValueFlow::Value::ValueType::UNINIT;
+    get(expr).valueType = ValueFlow::Value::ValueType::UNINIT;
 }
 
 bool ProgramMemory::hasValue(nonneg int exprid) const
 {
-    const auto it = find(exprid);
-    return it != mValues->cend();
+    return find(exprid) != nullptr;
 }
 
 const ValueFlow::Value& ProgramMemory::at(nonneg int exprid) const {
-    const auto it = find(exprid);
-    if (it == mValues->cend()) {
+    const value_type* p = find(exprid);
+    if (!p) {
         throw std::out_of_range("ProgramMemory::at");
     }
-    return it->second;
+    return p->second;
 }
 
 ValueFlow::Value& ProgramMemory::at(nonneg int exprid) {
-    copyOnWrite();
-
-    const auto it = find(exprid);
-    if (it == mValues->end()) {
+    if (!find(exprid)) {
         throw std::out_of_range("ProgramMemory::at");
     }
-    return it->second;
+    return get(ExprIdToken::create(exprid));
 }
 
 void ProgramMemory::erase_if(const std::function<bool(const ExprIdToken&)>& pred)
 {
-    if (mValues->empty())
-        return;
-
-    // TODO: how to delay until we actuallly modify?
-    copyOnWrite();
-
-    for (auto it = mValues->begin(); it != mValues->end();) {
-        if (pred(it->first))
-            it = mValues->erase(it);
-        else
-            ++it;
+    std::vector<nonneg int> exprids;
+    for (const value_type& p : *this) {
+        if (pred(p.first))
+            exprids.push_back(p.first.getExpressionId());
+    }
+    for (const nonneg int exprid : exprids) {
+        if (erase(mRoot, exprid, 0))
+            mRoot.reset();
+        --mSize;
     }
 }
 
 void ProgramMemory::swap(ProgramMemory &pm) NOEXCEPT
 {
-    mValues.swap(pm.mValues);
+    mRoot.swap(pm.mRoot);
+    std::swap(mSize, pm.mSize);
 }
 
 void ProgramMemory::clear()
 {
-    if (mValues->empty())
-        return;
-
-    copyOnWrite();
-
-    mValues->clear();
-}
-
-bool ProgramMemory::empty() const
-{
-    return mValues->empty();
+    mRoot.reset();
+    mSize = 0;
 }
 
 // NOLINTNEXTLINE(performance-unnecessary-value-param) - technically correct but we are moving the given values
@@ -231,37 +362,35 @@ void ProgramMemory::replace(ProgramMemory pm, bool skipUnknown)
     if (pm.empty())
         return;
 
-    copyOnWrite();
+    if (empty()) {
+        swap(pm);
+        return;
+    }
 
-    for (auto&& p : (*pm.mValues)) {
+    // the values are shared with pm
+    std::vector<std::shared_ptr<value_type>> leaves;
+    leaves.reserve(pm.size());
+    std::vector<const Node*> nodes{pm.mRoot.get()};
+    while (!nodes.empty()) {
+        const Node* node = nodes.back();
+        nodes.pop_back();
+        for (const Entry& e : node->entries) {
+            if (e.child)
+                nodes.push_back(e.child.get());
+            else
+                leaves.push_back(e.leaf);
+        }
+    }
+    for (std::shared_ptr<value_type>& leaf : leaves) {
         if (skipUnknown) {
-            auto it = mValues->find(p.first);
-            if (it != mValues->end() && it->second.isUninitValue())
+            const value_type* p = find(leaf->first.getExpressionId());
+            if (p && p->second.isUninitValue())
                 continue;
         }
-        (*mValues)[p.first] = std::move(p.second);
+        insert(std::move(leaf));
     }
 }
 
-void ProgramMemory::copyOnWrite()
-{
-    if (mValues.use_count() == 1)
-        return;
-
-    mValues = std::make_shared<Map>(*mValues);
-}
-
-ProgramMemory::Map::const_iterator ProgramMemory::find(nonneg int exprid) const
-{
-    const auto& cvalues = utils::as_const(*mValues);
-    return cvalues.find(ExprIdToken::create(exprid));
-}
-
-ProgramMemory::Map::iterator ProgramMemory::find(nonneg int exprid)
-{
-    return mValues->find(ExprIdToken::create(exprid));
-}
-
 static ValueFlow::Value execute(const Token* expr, ProgramMemory& pm, const Settings& settings);
 
 static bool evaluateCondition(MathLib::bigint r, const Token* condition, ProgramMemory& pm, const Settings& settings)
@@ -25,6 +25,7 @@
 
 #include <cstddef>
 #include <functional>
+#include <iterator>
 #include <map>
 #include <memory>
 #include <string>
@@ -101,12 +102,72 @@ private:
     explicit ExprIdToken(nonneg int exprId);
 };
 
+/**
+ * @brief Values of expressions while code is executed.
+ *
+ * The values are stored in a persistent hash trie that is indexed by the expression id.
+ * Copies share all nodes, and modifying a copy only copies the nodes on the path to the
+ * modified value. That keeps forking the memory at branches cheap.
+ */
 struct CPPCHECKLIB ProgramMemory {
     using Map = std::unordered_map<ExprIdToken, ValueFlow::Value, ExprIdToken::Hash>;
+    using value_type = std::pair<const ExprIdToken, ValueFlow::Value>;
+
+private:
+    struct Entry;
+    struct Node;
+    /** number of levels needed to index all bits of an expression id */
+    static constexpr int Depth = 7;
+
+public:
+    class CPPCHECKLIB const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = ProgramMemory::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        const_iterator() = default;
+
+        reference operator*() const {
+            return *mLeaf;
+        }
+        pointer operator->() const {
+            return mLeaf;
+        }
+
+        const_iterator& operator++() {
+            next();
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator it = *this;
+            next();
+            return it;
+        }
+
+        bool operator==(const const_iterator& rhs) const {
+            return mLeaf == rhs.mLeaf;
+        }
+        bool operator!=(const const_iterator& rhs) const {
+            return mLeaf != rhs.mLeaf;
+        }
+
+    private:
+        friend struct ProgramMemory;
+        explicit const_iterator(const Node* root);
+        void next();
+
+        const Node* mNodes[Depth]{};
+        int mIndex[Depth]{};
+        int mLevel = -1;
+        const value_type* mLeaf{};
+    };
 
-    ProgramMemory() : mValues(new Map()) {}
+    ProgramMemory() = default;
 
-    explicit ProgramMemory(Map values) : mValues(new Map(std::move(values))) {}
+    explicit ProgramMemory(const Map& values);
 
     void setValue(const Token* expr, const ValueFlow::Value& value);
     const ValueFlow::Value* getValue(nonneg int exprid, bool impossible = false) const;
@@ -132,32 +193,43 @@ struct CPPCHECKLIB ProgramMemory {
 
     void clear();
 
-    bool empty() const;
+    bool empty() const {
+        return mSize == 0;
+    }
+
+    std::size_t size() const {
+        return mSize;
+    }
 
     void replace(ProgramMemory pm, bool skipUnknown = false);
 
-    Map::const_iterator begin() const {
-        return mValues->cbegin();
+    const_iterator begin() const {
+        return const_iterator(mRoot.get());
     }
 
-    Map::const_iterator end() const {
-        return mValues->cend();
+    const_iterator end() const {
+        return const_iterator();
     }
 
     friend bool operator==(const ProgramMemory& x, const ProgramMemory& y) {
-        return x.mValues == y.mValues;
+        return x.mRoot == y.mRoot;
     }
 
     friend bool operator!=(const ProgramMemory& x, const ProgramMemory& y) {
-        return x.mValues != y.mValues;
+        return x.mRoot != y.mRoot;
     }
 
 private:
-    void copyOnWrite();
-    Map::const_iterator find(nonneg int exprid) const;
-    Map::iterator find(nonneg int exprid);
-
-    std::shared_ptr<Map> mValues;
+    const value_type* find(nonneg int exprid) const;
+    /** Find the entry of the expression for modification, the entry has no value if it is new */
+    Entry& findEntry(nonneg int exprid);
+    /** Get the value of the expression for modification, a new value is inserted if there is none */
+    ValueFlow::Value& get(const ExprIdToken& expr);
+    void insert(std::shared_ptr<value_type> leaf);
+    static bool erase(std::shared_ptr<Node>& node, nonneg int exprid, int level);
+
+    std::shared_ptr<Node> mRoot;
+    std::size_t mSize{};
 };
 
 struct ProgramMemoryState {
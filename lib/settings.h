@@ -269,6 +269,9 @@ public:
     /** @brief Force checking the files with "too many" configurations (--force). */
     bool force{};
 
+    /** @brief Memory limit in MiB for the raw tokens of headers that are shared between files, 0 disables the cache (--header-cache=). */
+    int headerCacheSize{};
+
     /** @brief List of include paths, e.g. "my/includes/" which should be used
         for finding include files inside source files. (-I) */
     std::list<std::string> includePaths;
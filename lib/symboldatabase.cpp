@@ -2947,7 +2947,7 @@ static bool usingNamespace(const Scope *scope, const Token *first, const Token *
     const Token *tok2 = second;
     bool match = false;
     while (Token::Match(tok1, "%type% :: %type%") && Token::Match(tok2, "%type% :: %type%")) {
-        if (tok1->str() == tok2->str()) {
+        if (Token::sameStr(tok1, tok2)) {
             tok1 = tok1->tokAt(2);
             tok2 = tok2->tokAt(2);
             match = true;
@@ -3059,7 +3059,7 @@ bool Function::argsMatch(const Scope *scope, const Token *first, const Token *se
         return start;
     };
 
-    while (first->str() == second->str() &&
+    while (Token::sameStr(first, second) &&
            first->isLong() == second->isLong() &&
            first->isUnsigned() == second->isUnsigned()) {
         if (first->str() == "(")
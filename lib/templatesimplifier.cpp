@@ -1808,7 +1808,7 @@ void TemplateSimplifier::expandTemplate(
                 } else if (start->str() == templateDeclarationNameToken->str() &&
                            !(templateDeclaration.isFunction() && templateDeclaration.scope().empty() &&
                              (start->strAt(-1) == "." || Token::simpleMatch(start->tokAt(-2), ". template")))) {
-                    if (start->strAt(1) != "<" || Token::Match(start, newName.c_str()) || !inAssignment) {
+                    if (start->strAt(1) != "<" || Token::Match(start, newName) || !inAssignment) {
                         dst->insertTokenBefore(newName);
                         dst->previous()->linenr(start->linenr());
                         dst->previous()->column(start->column());
@@ -2196,7 +2196,7 @@ void TemplateSimplifier::expandTemplate(
                     if (closingBracket) {
                         // replace multi token name with single token name
                         if (tok3 == templateDeclarationNameToken ||
-                            Token::Match(tok3, newName.c_str())) {
+                            Token::Match(tok3, newName)) {
                             if (copy) {
                                 mTokenList.addtoken(newName, tok3);
                                 tok3 = closingBracket;
@@ -2252,7 +2252,7 @@ void TemplateSimplifier::expandTemplate(
                     const Token *par = tok3->next();
                     while (num < typeParametersInDeclaration.size() && par != closingBracket) {
                         const std::string pattern("[<,] " + typeParametersInDeclaration[num]->str() + " [,>]");
-                        if (!Token::Match(par, pattern.c_str()))
+                        if (!Token::Match(par, pattern))
                             break;
                         ++num;
                         par = par->tokAt(2);
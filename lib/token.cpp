@@ -30,20 +30,24 @@
 #include "valueflow.h"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cctype>
 #include <climits>
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <functional>
 #include <iostream>
 #include <iterator>
 #include <map>
+#include <new>
 #include <set>
 #include <sstream>
 #include <stack>
 #include <type_traits>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 
@@ -64,9 +68,10 @@ const std::string Token::mEmptyString;
 Token::Token(const TokenList& tokenlist, std::shared_ptr<TokensFrontBack> tokensFrontBack)
     : mList(tokenlist)
     , mTokensFrontBack(std::move(tokensFrontBack))
-    , mImpl(new Impl)
+    , mImpl(new (mTokensFrontBack->arena.allocateImpl()) Impl)
     , mIsC(mList.isC())
     , mIsCpp(mList.isCPP())
+    , mArenaAllocated(false)
 {}
 
 Token::Token(const Token* tok)
@@ -78,7 +83,36 @@ Token::Token(const Token* tok)
 
 Token::~Token()
 {
-    delete mImpl;
+    destroyImpl();
+}
+
+Token *Token::create(const TokenList& tokenlist, std::shared_ptr<TokensFrontBack> tokensFrontBack)
+{
+    TokenArena &arena = tokensFrontBack->arena;
+    auto *tok = new (arena.allocateToken()) Token(tokenlist, std::move(tokensFrontBack));
+    tok->mArenaAllocated = true;
+    return tok;
+}
+
+void Token::destroy(Token *tok)
+{
+    if (!tok->mArenaAllocated) {
+        delete tok;
+        return;
+    }
+    // the token might hold the last reference to the arena
+    const std::shared_ptr<TokensFrontBack> tokensFrontBack = tok->mTokensFrontBack;
+    tok->~Token();
+    tokensFrontBack->arena.deallocateToken(tok);
+}
+
+void Token::destroyImpl()
+{
+    if (!mImpl)
+        return;
+    mImpl->~Impl();
+    mTokensFrontBack->arena.deallocateImpl(mImpl);
+    mImpl = nullptr;
 }
 
 /*
@@ -106,6 +140,16 @@ static const std::unordered_set<std::string> controlFlowKeywords = {
     "return"
 };
 
+void Token::internStr()
+{
+    mStrId = mTokensFrontBack->strings.intern(mStr);
+}
+
+std::uint8_t Token::strProperties() const
+{
+    return mTokensFrontBack->strings.properties(mStrId, mList);
+}
+
 void Token::update_property_info()
 {
     assert(mImpl);
@@ -135,11 +179,11 @@ void Token::update_property_info()
         else if (std::isalpha(static_cast<unsigned char>(mStr[0])) || mStr[0] == '_' || mStr[0] == '$') { // Name
             if (mImpl->mVarId)
                 tokType(eVariable);
-            else if (mList.isKeyword(mStr)) {
+            else if (strProperties() & TokenStrings::fKeyword) {
                 tokType(eKeyword);
                 update_property_isStandardType();
                 if (mTokType != eType) // cannot be a control-flow keyword when it is a type
-                    setFlag(fIsControlFlowKeyword, controlFlowKeywords.find(mStr) != controlFlowKeywords.end());
+                    setFlag(fIsControlFlowKeyword, (strProperties() & TokenStrings::fControlFlowKeyword) != 0);
             }
             else if (mStr == "asm") { // TODO: not a keyword
                 tokType(eKeyword);
@@ -221,7 +265,7 @@ void Token::update_property_isStandardType()
     if (mStr.size() < 3 || mStr.size() > 7)
         return;
 
-    if (isStandardType(mStr)) {
+    if (strProperties() & TokenStrings::fStandardType) {
         isStandardType(true);
         tokType(eType);
     }
@@ -244,6 +288,7 @@ void Token::concatStr(std::string const& b)
     if (isCChar() && isStringLiteral(b) && b[0] != '"') {
         mStr.insert(0, b.substr(0, b.find('"')));
     }
+    internStr();
     update_property_info();
 }
 
@@ -269,8 +314,40 @@ std::string Token::strValue() const
     return ret;
 }
 
+void Token::next(Token *nextToken)
+{
+    mNext = nextToken;
+    dropTokenIndex();
+}
+
+void Token::previous(Token *previousToken)
+{
+    mPrevious = previousToken;
+    dropTokenIndex();
+}
+
+void Token::dropTokenIndex()
+{
+    std::vector<Token*>& tokens = mTokensFrontBack->tokenIndex;
+    if (!tokens.empty())
+        tokens.clear();
+}
+
+Token *Token::tokAtIndexed(const Token *tok, int index, bool &indexed)
+{
+    const std::vector<Token*>& tokens = tok->mTokensFrontBack->tokenIndex;
+    indexed = !tokens.empty();
+    if (!indexed)
+        return nullptr;
+    const long long pos = static_cast<long long>(tok->mImpl->mIndex) - 1 + index;
+    if (pos < 0 || pos >= static_cast<long long>(tokens.size()))
+        return nullptr;
+    return tokens[pos];
+}
+
 void Token::deleteNext(nonneg int count)
 {
+    dropTokenIndex();
     while (mNext && count > 0) {
         Token *n = mNext;
 
@@ -279,7 +356,7 @@ void Token::deleteNext(nonneg int count)
             n->mLink->link(nullptr);
 
         mNext = n->next();
-        delete n;
+        destroy(n);
         --count;
     }
 
@@ -291,6 +368,7 @@ void Token::deleteNext(nonneg int count)
 
 void Token::deletePrevious(nonneg int count)
 {
+    dropTokenIndex();
     while (mPrevious && count > 0) {
         Token *p = mPrevious;
 
@@ -299,7 +377,7 @@ void Token::deletePrevious(nonneg int count)
             p->mLink->link(nullptr);
 
         mPrevious = p->previous();
-        delete p;
+        destroy(p);
         --count;
     }
 
@@ -312,19 +390,21 @@ void Token::deletePrevious(nonneg int count)
 void Token::swapWithNext()
 {
     if (mNext) {
+        dropTokenIndex();
         std::swap(mStr, mNext->mStr);
+        std::swap(mStrId, mNext->mStrId);
         std::swap(mTokType, mNext->mTokType);
         std::swap(mFlags, mNext->mFlags);
         std::swap(mImpl, mNext->mImpl);
-        if (mImpl->mTemplateSimplifierPointers)
+        if (templateSimplifierPointers())
             // cppcheck-suppress shadowFunction - TODO: fix this
-            for (auto *templateSimplifierPointer : *mImpl->mTemplateSimplifierPointers) {
+            for (auto *templateSimplifierPointer : *templateSimplifierPointers()) {
                 templateSimplifierPointer->token(this);
             }
 
-        if (mNext->mImpl->mTemplateSimplifierPointers)
+        if (mNext->templateSimplifierPointers())
             // cppcheck-suppress shadowFunction - TODO: fix this
-            for (auto *templateSimplifierPointer : *mNext->mImpl->mTemplateSimplifierPointers) {
+            for (auto *templateSimplifierPointer : *mNext->templateSimplifierPointers()) {
                 templateSimplifierPointer->token(mNext);
             }
         if (mNext->mLink)
@@ -337,15 +417,17 @@ void Token::swapWithNext()
 
 void Token::takeData(Token *fromToken)
 {
+    dropTokenIndex();
     mStr = fromToken->mStr;
+    mStrId = fromToken->mStrId;
     tokType(fromToken->mTokType);
     mFlags = fromToken->mFlags;
-    delete mImpl;
+    destroyImpl();
     mImpl = fromToken->mImpl;
     fromToken->mImpl = nullptr;
-    if (mImpl->mTemplateSimplifierPointers)
+    if (templateSimplifierPointers())
         // cppcheck-suppress shadowFunction - TODO: fix this
-        for (auto *templateSimplifierPointer : *mImpl->mTemplateSimplifierPointers) {
+        for (auto *templateSimplifierPointer : *templateSimplifierPointers()) {
             templateSimplifierPointer->token(this);
         }
     mLink = fromToken->mLink;
@@ -400,7 +482,7 @@ void Token::replace(Token *replaceThis, Token *start, Token *end)
         tok->mImpl->mProgressValue = replaceThis->mImpl->mProgressValue;
 
     // Delete old token, which is replaced
-    delete replaceThis;
+    destroy(replaceThis);
 }
 
 /**
@@ -665,7 +747,7 @@ const char *Token::chrInFirstWord(const char *str, char c)
     }
 }
 
-bool Token::Match(const Token *tok, const char pattern[], nonneg int varid)
+bool Token::matchParsed(const Token *tok, const char pattern[], nonneg int varid)
 {
     if (!(*pattern))
         return true;
@@ -754,6 +836,329 @@ bool Token::Match(const Token *tok, const char pattern[], nonneg int varid)
     return true;
 }
 
+/**
+ * A Token::Match() pattern that is split into words and alternatives once,
+ * so matching does not need to parse it again. The result of match() is
+ * the same as the result of matchParsed() for the pattern.
+ */
+class Token::MatchPattern {
+public:
+    explicit MatchPattern(std::string pattern);
+
+    bool match(const Token *tok, nonneg int varid) const;
+
+    const std::string &text() const {
+        return mPattern;
+    }
+
+    /** the token that the pattern starts with, or nullptr if it starts with something else */
+    const std::string *first() const {
+        if (mParse || mWords.empty() || mWords[0].kind != Word::Kind::Str)
+            return nullptr;
+        return &mWords[0].str;
+    }
+
+private:
+    enum class Command : std::uint8_t {
+        None, Any, Assign, Bool, Char, Comp, Cop, Name, Num, Op, Or, Oror, Str, Type, Var, Varid
+    };
+
+    struct Alternative {
+        Command command;
+        std::string str;
+    };
+
+    struct Word {
+        enum class Kind : std::uint8_t { Str, Alternatives, Chars, Not };
+        Kind kind;
+        /** the last alternative is empty, the word can match without using a token */
+        bool optional;
+        /** Str: the token, Chars: the accepted characters, Not: the rejected token */
+        std::string str;
+        std::vector<Alternative> alternatives;
+    };
+
+    static Command command(const std::string &str);
+    static bool matchCommand(const Token *tok, Command command, nonneg int varid);
+    static int matchAlternatives(const Token *tok, const Word &word, nonneg int varid);
+
+    std::string mPattern;
+
+    std::vector<Word> mWords;
+
+    /** the pattern contains an unknown %cmd%, it is left to matchParsed() */
+    bool mParse{};
+};
+
+Token::MatchPattern::MatchPattern(std::string pattern)
+    : mPattern(std::move(pattern))
+{
+    const char *p = mPattern.c_str();
+    for (;;) {
+        while (*p == ' ')
+            ++p;
+        if (*p == '\0')
+            break;
+        const char *end = p;
+        while (*end && *end != ' ')
+            ++end;
+        const std::string str(p, end);
+
+        Word word{};
+        if (str[0] == '[' && str.find(']') != std::string::npos) {
+            word.kind = Word::Kind::Chars;
+            std::copy_if(str.cbegin() + 1, str.cend(), std::back_inserter(word.str), [](char c) {
+                return c != ']';
+            });
+            if (std::count(str.cbegin(), str.cend(), ']') > 1)
+                word.str += ']';
+        } else if (p[0] == '!' && p[1] == '!' && p[2] != '\0') {
+            word.kind = Word::Kind::Not;
+            word.str = str.substr(2);
+        } else {
+            word.kind = Word::Kind::Alternatives;
+            std::string::size_type start = 0;
+            for (;;) {
+                const std::string::size_type bar = str.find('|', start);
+                std::string alt = str.substr(start, bar - start);
+                // only an empty last alternative makes the word optional, other ones match empty tokens
+                if (bar == std::string::npos && alt.empty()) {
+                    word.optional = true;
+                    break;
+                }
+                const Command cmd = (alt.size() > 1 && alt[0] == '%') ? command(alt) : Command::None;
+                if (cmd == Command::None && alt.size() > 1 && alt[0] == '%') {
+                    mWords.clear();
+                    mParse = true;
+                    return;
+                }
+                word.alternatives.push_back({cmd, cmd == Command::None ? std::move(alt) : std::string()});
+                if (bar == std::string::npos)
+                    break;
+                start = bar + 1;
+            }
+            if (!word.optional && word.alternatives.size() == 1 && word.alternatives[0].command == Command::None) {
+                word.kind = Word::Kind::Str;
+                word.str = std::move(word.alternatives[0].str);
+                word.alternatives.clear();
+            } else if (!word.optional && std::all_of(word.alternatives.cbegin(), word.alternatives.cend(), [](const Alternative &alt) {
+                return alt.command == Command::None && alt.str.size() == 1;
+            })) {
+                // "(|{|[" is the same as "[({[]"
+                word.kind = Word::Kind::Chars;
+                for (const Alternative &alt : word.alternatives)
+                    word.str += alt.str;
+                word.alternatives.clear();
+            }
+        }
+        mWords.push_back(std::move(word));
+        p = end;
+    }
+}
+
+Token::MatchPattern::Command Token::MatchPattern::command(const std::string &str)
+{
+    static const std::unordered_map<std::string, Command> commands = {
+        { "%any%", Command::Any },
+        { "%assign%", Command::Assign },
+        { "%bool%", Command::Bool },
+        { "%char%", Command::Char },
+        { "%comp%", Command::Comp },
+        { "%cop%", Command::Cop },
+        { "%name%", Command::Name },
+        { "%num%", Command::Num },
+        { "%op%", Command::Op },
+        { "%or%", Command::Or },
+        { "%oror%", Command::Oror },
+        { "%str%", Command::Str },
+        { "%type%", Command::Type },
+        { "%var%", Command::Var },
+        { "%varid%", Command::Varid }
+    };
+    const auto it = commands.find(str);
+    return it == commands.cend() ? Command::None : it->second;
+}
+
+/**
+ * @throws InternalError thrown on %varid% with varid 0
+ */
+bool Token::MatchPattern::matchCommand(const Token *tok, Command command, nonneg int varid)
+{
+    switch (command) {
+    case Command::Any:
+        return true;
+    case Command::Assign:
+        return tok->isAssignmentOp();
+    case Command::Bool:
+        return tok->isBoolean();
+    case Command::Char:
+        return tok->tokType() == Token::eChar;
+    case Command::Comp:
+        return tok->isComparisonOp();
+    case Command::Cop:
+        return tok->isConstOp();
+    case Command::Name:
+        return tok->isName();
+    case Command::Num:
+        return tok->isNumber();
+    case Command::Op:
+        return tok->isOp();
+    case Command::Or:
+        return tok->tokType() == Token::eBitOp && tok->str() == "|";
+    case Command::Oror:
+        return tok->tokType() == Token::eLogicalOp && tok->str() == "||";
+    case Command::Str:
+        return tok->tokType() == Token::eString;
+    case Command::Type:
+        return tok->isName() && tok->varId() == 0;
+    case Command::Var:
+        return tok->varId() != 0;
+    case Command::Varid:
+        if (varid == 0)
+            throw InternalError(tok, "Internal error. Token::Match called with varid 0. Please report this to Cppcheck developers");
+        return tok->varId() == varid;
+    case Command::None:
+        break;
+    }
+    return false;
+}
+
+// compare the first character before calling memcmp(), most comparisons fail there
+static bool matchPatternEquals(const std::string &s1, const std::string &s2)
+{
+    return s1.size() == s2.size() && (s1.empty() || (s1[0] == s2[0] && std::memcmp(s1.data() + 1, s2.data() + 1, s1.size() - 1) == 0));
+}
+
+int Token::MatchPattern::matchAlternatives(const Token *tok, const Word &word, nonneg int varid)
+{
+    for (const Alternative &alt : word.alternatives) {
+        if (alt.command == Command::None ? matchPatternEquals(tok->str(), alt.str) : matchCommand(tok, alt.command, varid))
+            return 1;
+    }
+    return word.optional ? 0 : -1;
+}
+
+bool Token::MatchPattern::match(const Token *tok, nonneg int varid) const
+{
+    if (mParse)
+        return matchParsed(tok, mPattern.c_str(), varid);
+
+    for (const Word &word : mWords) {
+        if (!tok) {
+            // If we have no tokens, pattern "!!else" should return true
+            if (word.kind == Word::Kind::Not)
+                continue;
+            return false;
+        }
+
+        if (word.kind == Word::Kind::Str) {
+            if (!matchPatternEquals(tok->str(), word.str))
+                return false;
+        } else if (word.kind == Word::Kind::Alternatives) {
+            const int res = matchAlternatives(tok, word, varid);
+            // Empty alternative matches, use the same token for the next word
+            if (res == 0)
+                continue;
+            if (res == -1)
+                return false;
+        } else if (word.kind == Word::Kind::Chars) {
+            if (tok->str().size() != 1 || std::find(word.str.cbegin(), word.str.cend(), tok->str()[0]) == word.str.cend())
+                return false;
+        } else if (matchPatternEquals(tok->str(), word.str)) {
+            return false;
+        }
+
+        tok = tok->next();
+    }
+    return true;
+}
+
+bool Token::matchCompiled(const Token *tok, const char pattern[], nonneg int varid)
+{
+    // A string literal is identified by its address. Each thread compiles the patterns it
+    // uses and remembers the recently used ones in a small table indexed by the address.
+    // The table also holds the first token of the pattern so most mismatches are found
+    // without looking at the compiled pattern.
+    struct Recent {
+        const char *pattern;
+        const MatchPattern *compiled;
+        std::size_t firstSize;
+        char firstChar;
+    };
+    thread_local static std::array<Recent, 2048> recent{};
+
+    const auto address = reinterpret_cast<std::uintptr_t>(pattern);
+    Recent &r = recent[((address >> 2) ^ (address >> 13)) % recent.size()];
+    if (r.pattern != pattern) {
+        thread_local static std::unordered_map<const char *, MatchPattern> compiled;
+        auto it = compiled.find(pattern);
+        if (it == compiled.end())
+            it = compiled.emplace(pattern, MatchPattern(pattern)).first;
+        const std::string *first = it->second.first();
+        r.pattern = pattern;
+        r.compiled = &it->second;
+        r.firstSize = first ? first->size() : 0;
+        r.firstChar = first ? (*first)[0] : '\0';
+    }
+    if (r.firstSize > 0 && (!tok || tok->mStr.size() != r.firstSize || tok->mStr[0] != r.firstChar))
+        return false;
+    return r.compiled->match(tok, varid);
+}
+
+const Token::MatchPattern *Token::compiledPattern(const std::string &pattern)
+{
+    // Patterns built at runtime are identified by their text and each thread compiles the patterns
+    // it uses. Patterns can contain names from the code, when there are too many of them the new
+    // ones are not compiled.
+    thread_local static std::unordered_map<std::string, MatchPattern> compiled;
+    auto it = compiled.find(pattern);
+    if (it == compiled.end()) {
+        if (compiled.size() >= 4096)
+            return nullptr;
+        it = compiled.emplace(pattern, MatchPattern(pattern)).first;
+    }
+    return &it->second;
+}
+
+bool Token::Match(const Token *tok, const std::string &pattern, nonneg int varid)
+{
+    // The pattern last used with each std::string object is remembered so its text does not need
+    // to be hashed again. The string can have been modified since then, so its first word is
+    // compared before a token is rejected by it and the whole text before the pattern is used.
+    struct Recent {
+        const char *data;
+        const MatchPattern *compiled;
+        /** the pattern starts with a token of this size that is stored in first */
+        std::size_t firstSize;
+        std::array<char, 8> first;
+    };
+    thread_local static std::array<Recent, 256> recent{};
+
+    const char *data = pattern.data();
+    const auto address = reinterpret_cast<std::uintptr_t>(data);
+    Recent &r = recent[((address >> 4) ^ (address >> 12)) % recent.size()];
+    if (r.data == data && r.firstSize > 0 && pattern.size() >= r.firstSize &&
+        (pattern.size() == r.firstSize || pattern[r.firstSize] == ' ') &&
+        std::memcmp(data, r.first.data(), r.firstSize) == 0) {
+        if (!tok || tok->mStr.size() != r.firstSize || std::memcmp(tok->mStr.data(), data, r.firstSize) != 0)
+            return false;
+    }
+    if (r.data != data || r.compiled->text() != pattern) {
+        const MatchPattern *compiled = compiledPattern(pattern);
+        if (!compiled)
+            return matchParsed(tok, pattern.c_str(), varid);
+        // "!!" is only a token at the end of a pattern
+        const std::string *first = compiled->first();
+        const bool useFirst = first && first->size() <= r.first.size() && *first != "!!" && pattern.compare(0, first->size(), *first) == 0;
+        r.data = data;
+        r.compiled = compiled;
+        r.firstSize = useFirst ? first->size() : 0;
+        if (useFirst)
+            std::copy(first->cbegin(), first->cend(), r.first.begin());
+    }
+    return r.compiled->match(tok, varid);
+}
+
 nonneg int Token::getStrLength(const Token *tok)
 {
     assert(tok != nullptr);
@@ -1013,11 +1418,11 @@ Token *Token::findsimplematch(Token * const startTok, const char pattern[], size
     return findsimplematchImpl(startTok, pattern, pattern_len, end);
 }
 
-template<class T, REQUIRES("T must be a Token class", std::is_convertible<T*, const Token*> )>
-static T *findmatchImpl(T * const startTok, const char pattern[], const nonneg int varId)
+template<class T, class P, REQUIRES("T must be a Token class", std::is_convertible<T*, const Token*> )>
+static T *findmatchImpl(T * const startTok, const P &pattern, const nonneg int varId)
 {
     for (T* tok = startTok; tok; tok = tok->next()) {
-        if (Token::Match(tok, pattern, varId))
+        if (pattern.match(tok, varId))
             return tok;
     }
     return nullptr;
@@ -1025,18 +1430,24 @@ static T *findmatchImpl(T * const startTok, const char pattern[], const nonneg i
 
 const Token *Token::findmatch(const Token * const startTok, const char pattern[], const nonneg int varId)
 {
-    return findmatchImpl(startTok, pattern, varId);
+    const MatchPattern *compiled = compiledPattern(pattern);
+    if (compiled)
+        return findmatchImpl(startTok, *compiled, varId);
+    return findmatchImpl(startTok, MatchPattern(pattern), varId);
 }
 
 Token *Token::findmatch(Token * const startTok, const char pattern[], const nonneg int varId) {
-    return findmatchImpl(startTok, pattern, varId);
+    const MatchPattern *compiled = compiledPattern(pattern);
+    if (compiled)
+        return findmatchImpl(startTok, *compiled, varId);
+    return findmatchImpl(startTok, MatchPattern(pattern), varId);
 }
 
-template<class T, REQUIRES("T must be a Token class", std::is_convertible<T*, const Token*> )>
-static T *findmatchImpl(T * const startTok, const char pattern[], const Token * const end, const nonneg int varId)
+template<class T, class P, REQUIRES("T must be a Token class", std::is_convertible<T*, const Token*> )>
+static T *findmatchImpl(T * const startTok, const P &pattern, const Token * const end, const nonneg int varId)
 {
     for (T* tok = startTok; tok && tok != end; tok = tok->next()) {
-        if (Token::Match(tok, pattern, varId))
+        if (pattern.match(tok, varId))
             return tok;
     }
     return nullptr;
@@ -1044,11 +1455,17 @@ static T *findmatchImpl(T * const startTok, const char pattern[], const Token *
 
 const Token *Token::findmatch(const Token * const startTok, const char pattern[], const Token * const end, const nonneg int varId)
 {
-    return findmatchImpl(startTok, pattern, end, varId);
+    const MatchPattern *compiled = compiledPattern(pattern);
+    if (compiled)
+        return findmatchImpl(startTok, *compiled, end, varId);
+    return findmatchImpl(startTok, MatchPattern(pattern), end, varId);
 }
 
 Token *Token::findmatch(Token * const startTok, const char pattern[], const Token * const end, const nonneg int varId) {
-    return findmatchImpl(startTok, pattern, end, varId);
+    const MatchPattern *compiled = compiledPattern(pattern);
+    if (compiled)
+        return findmatchImpl(startTok, *compiled, end, varId);
+    return findmatchImpl(startTok, MatchPattern(pattern), end, varId);
 }
 
 void Token::function(const Function *f)
@@ -1069,7 +1486,7 @@ Token* Token::insertToken(const std::string& tokenStr, bool prepend)
     if (mStr.empty())
         newToken = this;
     else
-        newToken = new Token(mList, mTokensFrontBack);
+        newToken = create(mList, mTokensFrontBack);
     newToken->str(tokenStr);
 
     if (newToken != this) {
@@ -1097,7 +1514,7 @@ Token* Token::insertToken(const std::string& tokenStr, bool prepend)
             newToken->previous(this);
         }
 
-        if (mImpl->mScopeInfo) {
+        if (mImpl->mCold && mImpl->mCold->mScopeInfo) {
             // If the brace is immediately closed there is no point opening a new scope for it
             if (newToken->str() == "{") {
                 std::string nextScopeNameAddition;
@@ -1149,7 +1566,7 @@ Token* Token::insertToken(const std::string& tokenStr, bool prepend)
                 }
 
                 // New scope is opening, record it here
-                std::shared_ptr<ScopeInfo2> newScopeInfo = std::make_shared<ScopeInfo2>(mImpl->mScopeInfo->name, nullptr, mImpl->mScopeInfo->usingNamespaces);
+                std::shared_ptr<ScopeInfo2> newScopeInfo = std::make_shared<ScopeInfo2>(mImpl->mCold->mScopeInfo->name, nullptr, mImpl->mCold->mScopeInfo->usingNamespaces);
 
                 if (!newScopeInfo->name.empty() && !nextScopeNameAddition.empty()) newScopeInfo->name.append(" :: ");
                 newScopeInfo->name.append(nextScopeNameAddition);
@@ -1165,13 +1582,13 @@ Token* Token::insertToken(const std::string& tokenStr, bool prepend)
                     matchingTok = matchingTok->previous();
                 }
                 if (matchingTok && matchingTok->previous()) {
-                    newToken->mImpl->mScopeInfo = matchingTok->previous()->scopeInfo();
+                    newToken->scopeInfo(matchingTok->previous()->scopeInfo());
                 }
             } else {
                 if (prepend && newToken->previous()) {
-                    newToken->mImpl->mScopeInfo = newToken->previous()->scopeInfo();
+                    newToken->scopeInfo(newToken->previous()->scopeInfo());
                 } else {
-                    newToken->mImpl->mScopeInfo = mImpl->mScopeInfo;
+                    newToken->scopeInfo(mImpl->mCold->mScopeInfo);
                 }
                 if (newToken->str() == ";") {
                     const Token* statementStart = newToken;
@@ -1187,7 +1604,7 @@ Token* Token::insertToken(const std::string& tokenStr, bool prepend)
                             nameSpace += tok1->str();
                             tok1 = tok1->next();
                         }
-                        mImpl->mScopeInfo->usingNamespaces.insert(std::move(nameSpace));
+                        mImpl->mCold->mScopeInfo->usingNamespaces.insert(std::move(nameSpace));
                     }
                 }
             }
@@ -1765,7 +2182,7 @@ void Token::printValueFlow(const std::vector<std::string>& files, bool xml, std:
         outs += "\n\n##Value flow\n";
     for (const Token *tok = this; tok; tok = tok->next()) {
         // cppcheck-suppress shadowFunction - TODO: fix this
-        const auto* const values = tok->mImpl->mValues;
+        const auto* const values = tok->mImpl->mValues.get();
         if (!values)
             continue;
         if (values->empty()) // Values might be removed by removeContradictions
@@ -2208,6 +2625,8 @@ static void removeOverlaps(std::list<ValueFlow::Value>& values)
 // passes to try to catch most contradictions
 static void removeContradictions(std::list<ValueFlow::Value>& values)
 {
+    if (values.size() < 2)
+        return;
     removeOverlaps(values);
     for (int i = 0; i < 4; i++) {
         if (!removeContradiction(values))
@@ -2226,11 +2645,38 @@ static bool sameValueType(const ValueFlow::Value& x, const ValueFlow::Value& y)
     return true;
 }
 
+std::list<ValueFlow::Value>& Token::mutableValues()
+{
+    if (!mImpl->mValues)
+        mImpl->mValues = std::make_shared<std::list<ValueFlow::Value>>();
+    else if (mImpl->mValues.use_count() > 1)
+        mImpl->mValues = std::make_shared<std::list<ValueFlow::Value>>(*mImpl->mValues);
+    return *mImpl->mValues;
+}
+
+void Token::shareValues()
+{
+    if (mImpl->mValues->size() == 1 && mImpl->mValues.use_count() == 1 && TokenValues::isShareable(mImpl->mValues->front()))
+        mImpl->mValues = mTokensFrontBack->values.intern(mImpl->mValues->front());
+}
+
 bool Token::addValue(const ValueFlow::Value &value)
 {
+    if (value.isKnown() && TokenValues::isShareable(value) &&
+        (!mImpl->mValues || std::all_of(mImpl->mValues->cbegin(), mImpl->mValues->cend(), [&](const ValueFlow::Value& x) {
+        return sameValueType(x, value);
+    }))) {
+        // The known value replaces all current values => use the shared list
+        ValueFlow::Value v(value);
+        if (v.varId == 0)
+            v.varId = mImpl->mVarId;
+        mImpl->mValues = mTokensFrontBack->values.intern(v);
+        return true;
+    }
+
     if (value.isKnown() && mImpl->mValues) {
         // Clear all other values of the same type since value is known
-        mImpl->mValues->remove_if([&](const ValueFlow::Value& x) {
+        mutableValues().remove_if([&](const ValueFlow::Value& x) {
             return sameValueType(x, value);
         });
     }
@@ -2253,9 +2699,11 @@ bool Token::addValue(const ValueFlow::Value &value)
         if (mImpl->mValues->size() >= 10U)
             return false;
 
+        std::list<ValueFlow::Value>& values = mutableValues();
+
         // if value already exists, don't add it again
-        auto it = mImpl->mValues->begin();
-        for (; it != mImpl->mValues->end(); ++it) {
+        auto it = values.begin();
+        for (; it != values.end(); ++it) {
             // different types => continue
             if (it->valueType != value.valueType)
                 continue;
@@ -2283,28 +2731,36 @@ bool Token::addValue(const ValueFlow::Value &value)
         }
 
         // Add value
-        if (it == mImpl->mValues->end()) {
+        if (it == values.end()) {
             ValueFlow::Value v(value);
             if (v.varId == 0)
                 v.varId = mImpl->mVarId;
             if (v.isKnown() && v.isIntValue())
-                mImpl->mValues->push_front(std::move(v));
+                values.push_front(std::move(v));
             else
-                mImpl->mValues->push_back(std::move(v));
+                values.push_back(std::move(v));
         }
     } else {
         ValueFlow::Value v(value);
         if (v.varId == 0)
             v.varId = mImpl->mVarId;
-        mImpl->mValues = new std::list<ValueFlow::Value>;
-        mImpl->mValues->push_back(std::move(v));
+        mutableValues().push_back(std::move(v));
     }
 
     removeContradictions(*mImpl->mValues);
+    shareValues();
 
     return true;
 }
 
+void Token::removeValues(const std::function<bool(const ValueFlow::Value &)>& pred)
+{
+    if (!mImpl->mValues || std::none_of(mImpl->mValues->cbegin(), mImpl->mValues->cend(), pred))
+        return;
+    mutableValues().remove_if(pred);
+    shareValues();
+}
+
 void Token::assignProgressValues(Token *tok)
 {
     int total_count = 0;
@@ -2517,11 +2973,17 @@ std::string Token::typeStr(const Token* tok)
 
 void Token::scopeInfo(std::shared_ptr<ScopeInfo2> newScopeInfo)
 {
-    mImpl->mScopeInfo = std::move(newScopeInfo);
+    if (newScopeInfo) {
+        mImpl->cold().mScopeInfo = std::move(newScopeInfo);
+    } else if (mImpl->mCold) {
+        mImpl->mCold->mScopeInfo.reset();
+        if (mImpl->mCold->empty())
+            mImpl->mCold.reset();
+    }
 }
 std::shared_ptr<ScopeInfo2> Token::scopeInfo() const
 {
-    return mImpl->mScopeInfo;
+    return mImpl->mCold ? mImpl->mCold->mScopeInfo : nullptr;
 }
 
 // if there is a known INT value it will always be the first entry
@@ -2643,12 +3105,179 @@ const ValueFlow::Value* Token::getContainerSizeValue(const MathLib::bigint val)
     return it == mImpl->mValues->end() ? nullptr : &*it;
 }
 
+TokenStrings::TokenStrings()
+{
+    (void)intern(std::string());
+}
+
+nonneg int TokenStrings::intern(const std::string &str)
+{
+    const auto it = mIds.emplace(str, mStrings.size());
+    if (it.second) {
+        mStrings.push_back(&it.first->first);
+        mProperties.push_back(0);
+    }
+    return it.first->second;
+}
+
+std::uint8_t TokenStrings::properties(nonneg int id, const TokenList &list)
+{
+    std::uint8_t &props = mProperties[id];
+    if (props & fKnown)
+        return props;
+    const std::string &s = str(id);
+    props = fKnown;
+    if (list.isKeyword(s))
+        props |= fKeyword;
+    if (controlFlowKeywords.find(s) != controlFlowKeywords.end())
+        props |= fControlFlowKeyword;
+    if (Token::isStandardType(s))
+        props |= fStandardType;
+    return props;
+}
+
+bool TokenValues::isShareable(const ValueFlow::Value &value)
+{
+    return (value.isIntValue() || value.isFloatValue()) &&
+           !value.tokvalue && !value.condition && !value.capturetok &&
+           value.path == 0 && !value.conditional && !value.defaultArg &&
+           value.errorPath.empty() && value.debugPath().empty() && value.subexpressions().empty();
+}
+
+std::size_t TokenValues::KeyHash::operator()(const Key &key) const
+{
+    std::size_t h = std::hash<std::uint64_t> {}(key.floatValue);
+    h = h * 31 + std::hash<long long> {}(static_cast<long long>(key.intvalue));
+    h = h * 31 + std::hash<long long> {}(static_cast<long long>(key.varvalue));
+    h = h * 31 + std::hash<long long> {}(static_cast<long long>(key.wideintvalue));
+    h = h * 31 + std::hash<std::uint64_t> {}(key.attributes);
+    return h * 31 + key.varId;
+}
+
+std::shared_ptr<TokenValues::List> TokenValues::intern(const ValueFlow::Value &value)
+{
+    assert(isShareable(value));
+    Key key;
+    key.intvalue = value.intvalue;
+    key.varvalue = value.varvalue;
+    key.wideintvalue = value.wideintvalue;
+    std::memcpy(&key.floatValue, &value.floatValue, sizeof(key.floatValue));
+    key.attributes = static_cast<std::uint64_t>(value.valueType) |
+                     (static_cast<std::uint64_t>(value.valueKind) << 8) |
+                     (static_cast<std::uint64_t>(value.bound) << 16) |
+                     (static_cast<std::uint64_t>(static_cast<std::uint8_t>(value.indirect)) << 24) |
+                     (static_cast<std::uint64_t>(value.safe | (value.macro << 1)) << 32) |
+                     (static_cast<std::uint64_t>(value.unknownFunctionReturn) << 40) |
+                     (static_cast<std::uint64_t>(value.moveKind) << 48) |
+                     (static_cast<std::uint64_t>(static_cast<unsigned>(value.lifetimeScope) | (static_cast<unsigned>(value.lifetimeKind) << 4)) << 56);
+    key.varId = value.varId;
+    std::shared_ptr<List> &list = mLists[key];
+    if (!list)
+        list = std::make_shared<List>(1, value);
+    return list;
+}
+
+struct TokenArena::Slot {
+    alignas(Token) unsigned char token[sizeof(Token)];
+    alignas(Token::Impl) unsigned char impl[sizeof(Token::Impl)];
+};
+
+static constexpr std::size_t TOKEN_ARENA_CHUNK_SLOTS = 512;
+
+TokenArena::~TokenArena()
+{
+    for (void *chunk : mChunks)
+        ::operator delete(chunk);
+}
+
+TokenArena::Slot *TokenArena::newSlot()
+{
+    if (mCursor == mChunkEnd) {
+        void *chunk = ::operator new(TOKEN_ARENA_CHUNK_SLOTS * sizeof(Slot));
+        mChunks.push_back(chunk);
+        mCursor = static_cast<Slot *>(chunk);
+        mChunkEnd = mCursor + TOKEN_ARENA_CHUNK_SLOTS;
+    }
+    return mCursor++;
+}
+
+void TokenArena::push(FreeSlot *&list, void *p)
+{
+    auto *slot = static_cast<FreeSlot *>(p);
+    slot->next = list;
+    list = slot;
+}
+
+void *TokenArena::pop(FreeSlot *&list)
+{
+    FreeSlot *slot = list;
+    list = slot->next;
+    return slot;
+}
+
+void *TokenArena::allocateToken()
+{
+    ++mLive;
+    if (mFreeTokens)
+        return pop(mFreeTokens);
+    if (mPendingImpl) {
+        push(mFreeImpls, mPendingImpl);
+        mPendingImpl = nullptr;
+    }
+    // a new slot holds the token and the Impl that is allocated next by its constructor
+    Slot *slot = newSlot();
+    mPendingImpl = slot->impl;
+    return slot->token;
+}
+
+void TokenArena::deallocateToken(void *p)
+{
+    --mLive;
+    push(mFreeTokens, p);
+}
+
+void *TokenArena::allocateImpl()
+{
+    ++mLive;
+    if (mPendingImpl) {
+        void *p = mPendingImpl;
+        mPendingImpl = nullptr;
+        return p;
+    }
+    if (mFreeImpls)
+        return pop(mFreeImpls);
+    Slot *slot = newSlot();
+    push(mFreeTokens, slot->token);
+    return slot->impl;
+}
+
+void TokenArena::deallocateImpl(void *p)
+{
+    --mLive;
+    push(mFreeImpls, p);
+}
+
+void TokenArena::release()
+{
+    if (mLive != 0)
+        return;
+    for (void *chunk : mChunks)
+        ::operator delete(chunk);
+    mChunks.clear();
+    mCursor = mChunkEnd = nullptr;
+    mFreeTokens = mFreeImpls = nullptr;
+    mPendingImpl = nullptr;
+}
+
 Token::Impl::~Impl()
+{
+    delete mValueType;
+}
+
+Token::Impl::Cold::~Cold()
 {
     delete mMacroName;
     delete mOriginalName;
-    delete mValueType;
-    delete mValues;
 
     if (mTemplateSimplifierPointers) {
         for (auto *p : *mTemplateSimplifierPointers) {
@@ -2664,25 +3293,34 @@ Token::Impl::~Impl()
     }
 }
 
+bool Token::Impl::Cold::empty() const
+{
+    return mTemplateArgFileIndex == -1 && mTemplateArgLineNumber == -1 && mTemplateArgColumn == -1 &&
+           mBits == -1 &&
+           !mOriginalName && !mMacroName && !mTemplateSimplifierPointers && !mScopeInfo &&
+           !mCppcheckAttributes && mAttributeAlignas.empty() && mAttributeCleanup.empty();
+}
+
 void Token::Impl::setCppcheckAttribute(CppcheckAttributesType type, MathLib::bigint value)
 {
-    CppcheckAttributes *attr = mCppcheckAttributes;
+    CppcheckAttributes *attr = mCold ? mCold->mCppcheckAttributes : nullptr;
     while (attr && attr->type != type)
         attr = attr->next;
     if (attr)
         attr->value = value;
     else {
+        Cold &c = cold();
         attr = new CppcheckAttributes;
         attr->type = type;
         attr->value = value;
-        attr->next = mCppcheckAttributes;
-        mCppcheckAttributes = attr;
+        attr->next = c.mCppcheckAttributes;
+        c.mCppcheckAttributes = attr;
     }
 }
 
 bool Token::Impl::getCppcheckAttribute(CppcheckAttributesType type, MathLib::bigint &value) const
 {
-    const CppcheckAttributes *attr = mCppcheckAttributes;
+    const CppcheckAttributes *attr = mCold ? mCold->mCppcheckAttributes : nullptr;
     while (attr && attr->type != type)
         attr = attr->next;
     if (attr)
@@ -2736,9 +3374,12 @@ const Token* findLambdaEndScope(const Token* tok) {
 
 void Token::templateArgFrom(const Token* fromToken) {
     setFlag(fIsTemplateArg, fromToken != nullptr);
-    mImpl->mTemplateArgFileIndex = fromToken ? fromToken->mImpl->mFileIndex : -1;
-    mImpl->mTemplateArgLineNumber = fromToken ? fromToken->mImpl->mLineNumber : -1;
-    mImpl->mTemplateArgColumn = fromToken ? fromToken->mImpl->mColumn : -1;
+    if (!fromToken && !mImpl->mCold)
+        return;
+    Impl::Cold& cold = mImpl->cold();
+    cold.mTemplateArgFileIndex = fromToken ? fromToken->mImpl->mFileIndex : -1;
+    cold.mTemplateArgLineNumber = fromToken ? fromToken->mImpl->mLineNumber : -1;
+    cold.mTemplateArgColumn = fromToken ? fromToken->mImpl->mColumn : -1;
 }
 
 const SmallVector<ReferenceToken>& Token::refs(bool temporary) const
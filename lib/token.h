@@ -80,6 +80,7 @@ enum class TokenDebug : std::uint8_t { None, ValueFlow, ValueType };
  * The Token class also has other functions for management of token list, matching tokens, etc.
  */
 class CPPCHECKLIB Token {
+    friend class TokenArena;
 
 public:
     enum CppcheckAttributesType : std::uint8_t { LOW, HIGH };
@@ -93,11 +94,6 @@ private:
         nonneg int mColumn{};
         nonneg int mExprId{};
 
-        // original template argument location
-        int mTemplateArgFileIndex{-1};
-        int mTemplateArgLineNumber{-1};
-        int mTemplateArgColumn{-1};
-
         /**
          * A value from 0-100 that provides a rough idea about where in the token
          * list this token is located.
@@ -109,9 +105,6 @@ private:
          */
         nonneg int mIndex{};
 
-        /** Bitfield bit count. */
-        short mBits = -1;
-
         // AST..
         Token* mAstOperand1{};
         Token* mAstOperand2{};
@@ -127,23 +120,11 @@ private:
             const Enumerator *mEnumerator;
         };
 
-        // original name like size_t
-        std::string* mOriginalName{};
-
-        // If this token came from a macro replacement list, this is the name of that macro
-        std::string* mMacroName{};
-
         // ValueType
         ValueType* mValueType{};
 
         // ValueFlow
-        std::list<ValueFlow::Value>* mValues{};
-
-        // Pointer to a template in the template simplifier
-        std::set<TemplateSimplifier::TokenAndName*>* mTemplateSimplifierPointers{};
-
-        // Pointer to the object representing this token's scope
-        std::shared_ptr<ScopeInfo2> mScopeInfo;
+        std::shared_ptr<std::list<ValueFlow::Value>> mValues;
 
         // __cppcheck_in_range__
         struct CppcheckAttributes {
@@ -151,18 +132,59 @@ private:
             MathLib::bigint value{};
             CppcheckAttributes* next{};
         };
-        CppcheckAttributes* mCppcheckAttributes{};
 
-        // alignas expressions
-        std::unique_ptr<std::vector<std::string>> mAttributeAlignas;
-        void addAttributeAlignas(const std::string& a) {
-            if (!mAttributeAlignas)
-                mAttributeAlignas = std::unique_ptr<std::vector<std::string>>(new std::vector<std::string>());
-            if (std::find(mAttributeAlignas->cbegin(), mAttributeAlignas->cend(), a) == mAttributeAlignas->cend())
-                mAttributeAlignas->push_back(a);
+        // Data that only few tokens have. It is kept out of Impl so the data
+        // used by the AST and ValueFlow traversals shares fewer cache lines.
+        struct Cold {
+            // original template argument location
+            int mTemplateArgFileIndex{-1};
+            int mTemplateArgLineNumber{-1};
+            int mTemplateArgColumn{-1};
+
+            /** Bitfield bit count. */
+            short mBits = -1;
+
+            // original name like size_t
+            std::string* mOriginalName{};
+
+            // If this token came from a macro replacement list, this is the name of that macro
+            std::string* mMacroName{};
+
+            // Pointer to a template in the template simplifier
+            std::set<TemplateSimplifier::TokenAndName*>* mTemplateSimplifierPointers{};
+
+            // Pointer to the object representing this token's scope
+            std::shared_ptr<ScopeInfo2> mScopeInfo;
+
+            CppcheckAttributes* mCppcheckAttributes{};
+
+            // alignas expressions
+            std::vector<std::string> mAttributeAlignas;
+
+            std::string mAttributeCleanup;
+
+            Cold() = default;
+            ~Cold();
+
+            Cold(const Cold &) = delete;
+            Cold& operator=(const Cold &) = delete;
+
+            /** @return true if nothing is stored */
+            bool empty() const;
+        };
+        std::unique_ptr<Cold> mCold;
+
+        Cold& cold() {
+            if (!mCold)
+                mCold = std::unique_ptr<Cold>(new Cold);
+            return *mCold;
         }
 
-        std::string mAttributeCleanup;
+        void addAttributeAlignas(const std::string& a) {
+            std::vector<std::string>& attributeAlignas = cold().mAttributeAlignas;
+            if (std::find(attributeAlignas.cbegin(), attributeAlignas.cend(), a) == attributeAlignas.cend())
+                attributeAlignas.push_back(a);
+        }
 
         // For memoization, to speed up parsing of huge arrays #8897
         Cpp11init mCpp11init{Cpp11init::UNKNOWN};
@@ -209,6 +231,15 @@ public:
     explicit Token(const Token *tok);
     ~Token();
 
+    /**
+     * Create a token in the arena of the given list.
+     * The token must be released with destroy().
+     */
+    RET_NONNULL static Token *create(const TokenList& tokenlist, std::shared_ptr<TokensFrontBack> tokensFrontBack);
+
+    /** Release a token that was created with create() or new. */
+    static void destroy(Token *tok);
+
     ConstTokenRange until(const Token * t) const;
 
     template<typename T>
@@ -216,6 +247,7 @@ public:
         mStr = s;
         mImpl->mVarId = 0;
 
+        internStr();
         update_property_info();
     }
 
@@ -229,6 +261,24 @@ public:
         return mStr;
     }
 
+    /**
+     * @return id of the interned token string. Tokens of the same list have
+     * the same id if and only if their strings are equal.
+     */
+    nonneg int strId() const {
+        return mStrId;
+    }
+
+    /**
+     * @return true if both tokens have the same string. The interned ids are
+     * compared when the tokens belong to the same list.
+     */
+    static bool sameStr(const Token *tok1, const Token *tok2) {
+        if (tok1->mTokensFrontBack == tok2->mTokensFrontBack)
+            return tok1->mStrId == tok2->mStrId;
+        return tok1->mStr == tok2->mStr;
+    }
+
     /**
      * Unlink and delete the next 'count' tokens.
      */
@@ -349,8 +399,28 @@ public:
      * will be matched against this argument
      * @return true if given token matches with given pattern
      *         false if given token does not match with given pattern
+     *
+     * A string literal pattern is parsed only once. It is compiled into a
+     * list of token matchers the first time it is used; the pattern must
+     * have static storage duration.
      */
-    static bool Match(const Token *tok, const char pattern[], nonneg int varid = 0);
+    template<size_t count>
+    static bool Match(const Token *tok, const char (&pattern)[count], nonneg int varid = 0) {
+        return matchCompiled(tok, pattern, varid);
+    }
+
+    /** Match given token against a pattern that is built at runtime, see above */
+    template<class T, REQUIRES("T must be a C string", std::is_convertible<T, const char*> )>
+    static bool Match(const Token *tok, T pattern, nonneg int varid = 0) {
+        return matchParsed(tok, pattern, varid);
+    }
+
+    /**
+     * Match given token against a pattern that is built at runtime, see above.
+     * The pattern is compiled once for each text and kept in a per thread cache,
+     * use this when the same pattern is matched many times.
+     */
+    static bool Match(const Token *tok, const std::string &pattern, nonneg int varid = 0);
 
     /**
      * @return length of C-string.
@@ -500,7 +570,7 @@ public:
         setFlag(fIsStandardType, b);
     }
     bool isExpandedMacro() const {
-        return !!mImpl->mMacroName;
+        return mImpl->mCold && mImpl->mCold->mMacroName;
     }
     bool isCast() const {
         return getFlag(fIsCast);
@@ -587,22 +657,22 @@ public:
         setFlag(fIsAttributeFallthrough, value);
     }
     std::vector<std::string> getAttributeAlignas() const {
-        return mImpl->mAttributeAlignas ? *mImpl->mAttributeAlignas : std::vector<std::string>();
+        return mImpl->mCold ? mImpl->mCold->mAttributeAlignas : std::vector<std::string>();
     }
     bool hasAttributeAlignas() const {
-        return !!mImpl->mAttributeAlignas;
+        return mImpl->mCold && !mImpl->mCold->mAttributeAlignas.empty();
     }
     void addAttributeAlignas(const std::string& a) {
         mImpl->addAttributeAlignas(a);
     }
     void addAttributeCleanup(const std::string& funcname) {
-        mImpl->mAttributeCleanup = funcname;
+        mImpl->cold().mAttributeCleanup = funcname;
     }
     const std::string& getAttributeCleanup() const {
-        return mImpl->mAttributeCleanup;
+        return mImpl->mCold ? mImpl->mCold->mAttributeCleanup : mEmptyString;
     }
     bool hasAttributeCleanup() const {
-        return !mImpl->mAttributeCleanup.empty();
+        return mImpl->mCold && !mImpl->mCold->mAttributeCleanup.empty();
     }
     void setCppcheckAttribute(CppcheckAttributesType type, MathLib::bigint value) {
         mImpl->setCppcheckAttribute(type, value);
@@ -612,7 +682,7 @@ public:
     }
     // cppcheck-suppress unusedFunction
     bool hasCppcheckAttributes() const {
-        return nullptr != mImpl->mCppcheckAttributes;
+        return mImpl->mCold && nullptr != mImpl->mCold->mCppcheckAttributes;
     }
     bool isControlFlowKeyword() const {
         return getFlag(fIsControlFlowKeyword);
@@ -769,29 +839,31 @@ public:
 
     // cppcheck-suppress unusedFunction
     bool isBitfield() const {
-        return mImpl->mBits >= 0;
+        return bits() >= 0;
     }
     short bits() const {
-        return mImpl->mBits;
+        return mImpl->mCold ? mImpl->mCold->mBits : -1;
     }
     const std::set<TemplateSimplifier::TokenAndName*>* templateSimplifierPointers() const {
-        return mImpl->mTemplateSimplifierPointers;
+        return mImpl->mCold ? mImpl->mCold->mTemplateSimplifierPointers : nullptr;
     }
     std::set<TemplateSimplifier::TokenAndName*>* templateSimplifierPointers() {
-        return mImpl->mTemplateSimplifierPointers;
+        return mImpl->mCold ? mImpl->mCold->mTemplateSimplifierPointers : nullptr;
     }
     void templateSimplifierPointer(TemplateSimplifier::TokenAndName* tokenAndName) {
-        if (!mImpl->mTemplateSimplifierPointers)
-            mImpl->mTemplateSimplifierPointers = new std::set<TemplateSimplifier::TokenAndName*>;
-        mImpl->mTemplateSimplifierPointers->insert(tokenAndName);
+        Impl::Cold& cold = mImpl->cold();
+        if (!cold.mTemplateSimplifierPointers)
+            cold.mTemplateSimplifierPointers = new std::set<TemplateSimplifier::TokenAndName*>;
+        cold.mTemplateSimplifierPointers->insert(tokenAndName);
     }
     bool setBits(const MathLib::bigint b) {
         const MathLib::bigint max = std::numeric_limits<short>::max();
         if (b > max) {
-            mImpl->mBits = static_cast<short>(max);
+            mImpl->cold().mBits = static_cast<short>(max);
             return false;
         }
-        mImpl->mBits = b < 0 ? -1 : static_cast<short>(b);
+        if (b >= 0 || mImpl->mCold)
+            mImpl->cold().mBits = b < 0 ? -1 : static_cast<short>(b);
         return true;
     }
 
@@ -841,23 +913,24 @@ public:
     }
     void templateArgFrom(const Token* fromToken);
     int templateArgFileIndex() const {
-        return mImpl->mTemplateArgFileIndex;
+        return mImpl->mCold ? mImpl->mCold->mTemplateArgFileIndex : -1;
     }
     int templateArgLineNumber() const {
-        return mImpl->mTemplateArgLineNumber;
+        return mImpl->mCold ? mImpl->mCold->mTemplateArgLineNumber : -1;
     }
     int templateArgColumn() const {
-        return mImpl->mTemplateArgColumn;
+        return mImpl->mCold ? mImpl->mCold->mTemplateArgColumn : -1;
     }
 
     const std::string& getMacroName() const {
-        return mImpl->mMacroName ? *mImpl->mMacroName : mEmptyString;
+        return (mImpl->mCold && mImpl->mCold->mMacroName) ? *mImpl->mCold->mMacroName : mEmptyString;
     }
     void setMacroName(std::string name) {
-        if (!mImpl->mMacroName)
-            mImpl->mMacroName = new std::string(std::move(name));
+        Impl::Cold& cold = mImpl->cold();
+        if (!cold.mMacroName)
+            cold.mMacroName = new std::string(std::move(name));
         else
-            *mImpl->mMacroName = std::move(name);
+            *cold.mMacroName = std::move(name);
     }
 
     template<size_t count>
@@ -893,6 +966,12 @@ private:
     template<class T, REQUIRES("T must be a Token class", std::is_convertible<T*, const Token*> )>
     static T *tokAtImpl(T *tok, int index)
     {
+        if (tok && (index > 2 || index < -2)) {
+            bool indexed = false;
+            Token *indexedTok = tokAtIndexed(tok, index, indexed);
+            if (indexed)
+                return indexedTok;
+        }
         while (index > 0 && tok) {
             tok = tok->next();
             --index;
@@ -904,6 +983,9 @@ private:
         return tok;
     }
 
+    /** look up the token at the given offset in the token index, indexed is false if there is no token index */
+    static Token *tokAtIndexed(const Token *tok, int index, bool &indexed);
+
     /**
      * @throws InternalError thrown if index is out of range
      */
@@ -934,6 +1016,18 @@ protected:
      */
     static int multiCompare(const Token *tok, const char *haystack, nonneg int varid);
 
+private:
+    class MatchPattern;
+
+    /** Token::Match() that parses the pattern while matching */
+    static bool matchParsed(const Token *tok, const char pattern[], nonneg int varid);
+
+    /** Token::Match() that uses the compiled form of a string literal pattern */
+    static bool matchCompiled(const Token *tok, const char pattern[], nonneg int varid);
+
+    /** the compiled form of a pattern that is built at runtime, nullptr if too many patterns have been compiled */
+    static const MatchPattern *compiledPattern(const std::string &pattern);
+
 public:
     nonneg int fileIndex() const {
         return mImpl->mFileIndex;
@@ -1356,7 +1450,7 @@ public:
      * @return the original name.
      */
     const std::string & originalName() const {
-        return mImpl->mOriginalName ? *mImpl->mOriginalName : mEmptyString;
+        return (mImpl->mCold && mImpl->mCold->mOriginalName) ? *mImpl->mCold->mOriginalName : mEmptyString;
     }
 
     const std::list<ValueFlow::Value>& values() const {
@@ -1374,10 +1468,11 @@ public:
      */
     template<typename T>
     void originalName(T&& name) {
-        if (!mImpl->mOriginalName)
-            mImpl->mOriginalName = new std::string(name);
+        Impl::Cold& cold = mImpl->cold();
+        if (!cold.mOriginalName)
+            cold.mOriginalName = new std::string(name);
         else
-            *mImpl->mOriginalName = name;
+            *cold.mOriginalName = name;
     }
 
     bool hasKnownIntValue() const;
@@ -1414,10 +1509,7 @@ public:
     /** Add token value. Return true if value is added. */
     bool addValue(const ValueFlow::Value &value);
 
-    void removeValues(std::function<bool(const ValueFlow::Value &)> pred) {
-        if (mImpl->mValues)
-            mImpl->mValues->remove_if(std::move(pred));
-    }
+    void removeValues(const std::function<bool(const ValueFlow::Value &)>& pred);
 
     nonneg int index() const {
         return mImpl->mIndex;
@@ -1428,16 +1520,24 @@ public:
 private:
     static const std::list<ValueFlow::Value> mEmptyValueList;
 
-    void next(Token *nextToken) {
-        mNext = nextToken;
-    }
-    void previous(Token *previousToken) {
-        mPrevious = previousToken;
-    }
+    /** The values of this token, copied first if the list is shared with other tokens */
+    std::list<ValueFlow::Value>& mutableValues();
+
+    /** Use the shared list if there is only a single shareable value left */
+    void shareValues();
+
+    void next(Token *nextToken);
+    void previous(Token *previousToken);
+
+    /** drop the token index of the list, called whenever tokens are added, removed or moved */
+    void dropTokenIndex();
 
     /** used by deleteThis() to take data from token to delete */
     void takeData(Token *fromToken);
 
+    /** destruct and release mImpl */
+    void destroyImpl();
+
     /**
      * Works almost like strcmp() except returns only true or false and
      * if str has empty space &apos; &apos; character, that character is handled
@@ -1518,6 +1618,8 @@ private:
 
     Token::Type mTokType = eNone;
 
+    nonneg int mStrId{};
+
     uint64_t mFlags{};
 
     Impl* mImpl{};
@@ -1540,6 +1642,12 @@ private:
         mFlags = state_ ? mFlags | flag_ : mFlags & ~flag_;
     }
 
+    /** Updates mStrId after any mStr modification. */
+    void internStr();
+
+    /** @return TokenStrings properties of mStr */
+    std::uint8_t strProperties() const;
+
     /** Updates internal property cache like _isName or _isBoolean.
         Called after any mStr() modification.
         @throws InternalError thrown if a bool literal has a varid
@@ -1555,6 +1663,7 @@ private:
     // cppcheck-suppress premium-misra-cpp-2023-12.2.1
     bool mIsC : 1;
     bool mIsCpp : 1;
+    bool mArenaAllocated : 1;
 
 public:
     void astOperand1(Token *tok);
@@ -1640,8 +1749,7 @@ public:
     bool isCalculation() const;
 
     void clearValueFlow() {
-        delete mImpl->mValues;
-        mImpl->mValues = nullptr;
+        mImpl->mValues.reset();
     }
 
     // cppcheck-suppress unusedFunction - used in tests only
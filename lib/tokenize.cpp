@@ -42,9 +42,12 @@
 #include <array>
 #include <cassert>
 #include <cctype>
+#include <chrono>
+#include <cstddef>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <initializer_list>
 #include <iostream>
 #include <iterator>
 #include <limits>
@@ -3800,28 +3803,26 @@ void Tokenizer::simplifyParenthesizedLibraryFunctions()
     }
 }
 
-void Tokenizer::simplifyArrayAccessSyntax()
+Token* Tokenizer::simplifyArrayAccessSyntax(Token *tok)
 {
     // 0[a] -> a[0]
-    for (Token *tok = list.front(); tok; tok = tok->next()) {
-        if (tok->isNumber() && Token::Match(tok, "%num% [ %name% ]")) {
-            const std::string number(tok->str());
-            Token* indexTok = tok->tokAt(2);
-            tok->str(indexTok->str());
-            tok->varId(indexTok->varId());
-            indexTok->str(number);
-        }
+    if (tok->isNumber() && Token::Match(tok, "%num% [ %name% ]")) {
+        const std::string number(tok->str());
+        Token* indexTok = tok->tokAt(2);
+        tok->str(indexTok->str());
+        tok->varId(indexTok->varId());
+        indexTok->str(number);
     }
+    return tok;
 }
 
-void Tokenizer::simplifyParameterVoid()
+Token* Tokenizer::simplifyParameterVoid(Token *tok)
 {
-    for (Token* tok = list.front(); tok; tok = tok->next()) {
-        if (Token::Match(tok, "%name% ( void )") && !Token::Match(tok, "sizeof|decltype|typeof|return")) {
-            tok->next()->deleteNext();
-            tok->next()->setRemovedVoidParameter(true);
-        }
+    if (Token::Match(tok, "%name% ( void )") && !Token::Match(tok, "sizeof|decltype|typeof|return")) {
+        tok->next()->deleteNext();
+        tok->next()->setRemovedVoidParameter(true);
     }
+    return tok;
 }
 
 void Tokenizer::simplifyRedundantConsecutiveBraces()
@@ -3839,44 +3840,20 @@ void Tokenizer::simplifyRedundantConsecutiveBraces()
     }
 }
 
-void Tokenizer::simplifyDoublePlusAndDoubleMinus()
+Token* Tokenizer::simplifyDoublePlusAndDoubleMinus(Token *tok)
 {
     // Convert - - into + and + - into -
-    for (Token *tok = list.front(); tok; tok = tok->next()) {
-        while (tok->next()) {
-            if (tok->str() == "+") {
-                if (tok->strAt(1)[0] == '-') {
-                    tok = tok->next();
-                    if (tok->str().size() == 1) {
-                        tok = tok->previous();
-                        tok->str("-");
-                        tok->deleteNext();
-                    } else if (tok->isNumber()) {
-                        tok->str(tok->str().substr(1));
-                        tok = tok->previous();
-                        tok->str("-");
-                    }
-                    continue;
-                }
-            } else if (tok->str() == "-") {
-                if (tok->strAt(1)[0] == '-') {
-                    tok = tok->next();
-                    if (tok->str().size() == 1) {
-                        tok = tok->previous();
-                        tok->str("+");
-                        tok->deleteNext();
-                    } else if (tok->isNumber()) {
-                        tok->str(tok->str().substr(1));
-                        tok = tok->previous();
-                        tok->str("+");
-                    }
-                    continue;
-                }
-            }
-
+    while (tok->next() && (tok->str() == "+" || tok->str() == "-") && tok->strAt(1)[0] == '-') {
+        Token *next = tok->next();
+        if (next->str().size() == 1)
+            tok->deleteNext();
+        else if (next->isNumber())
+            next->str(next->str().substr(1));
+        else
             break;
-        }
+        tok->str(tok->str() == "+" ? "-" : "+");
     }
+    return tok;
 }
 
 /** Specify array size if it hasn't been given */
@@ -4226,6 +4203,10 @@ void Tokenizer::simplifyTemplates()
     const std::time_t maxTime = mSettings.templateMaxTime > 0 ? std::time(nullptr) + mSettings.templateMaxTime : 0;
     mTemplateSimplifier->simplifyTemplates(
         maxTime);
+
+    // the scope information is only used by the template simplifier
+    for (Token *tok = list.front(); tok; tok = tok->next())
+        tok->scopeInfo(nullptr);
 }
 //---------------------------------------------------------------------------
 
@@ -4619,10 +4600,11 @@ void Tokenizer::setVarIdClassFunction(const std::string &classname,
 {
     const auto pos = classname.rfind(' '); // TODO handle multiple scopes
     const std::string lastScope = classname.substr(pos == std::string::npos ? 0 : pos + 1);
+    const std::string notLastScope("!!" + lastScope + " ::");
     for (Token *tok2 = startToken; tok2 && tok2 != endToken; tok2 = tok2->next()) {
         if (tok2->varId() != 0 || !tok2->isName())
             continue;
-        if (Token::Match(tok2->tokAt(-2), ("!!" + lastScope + " ::").c_str()))
+        if (Token::Match(tok2->tokAt(-2), notLastScope))
             continue;
         if (Token::Match(tok2->tokAt(-4), "%name% :: %name% ::")) // Currently unsupported
             continue;
@@ -5848,11 +5830,13 @@ bool Tokenizer::simplifyTokenList1(const char FileName[])
     // remove unnecessary member qualification..
     removeUnnecessaryQualification();
 
-    // convert Microsoft memory functions
-    simplifyMicrosoftMemoryFunctions();
-
-    // convert Microsoft string functions
-    simplifyMicrosoftStringFunctions();
+    // convert Microsoft memory and string functions
+    if (mSettings.platform.isWindows()) {
+        simplifyPeepholes({
+            {"simplifyMicrosoftMemoryFunctions", &Tokenizer::simplifyMicrosoftMemoryFunctions},
+            {"simplifyMicrosoftStringFunctions", &Tokenizer::simplifyMicrosoftStringFunctions}
+        });
+    }
 
     if (Settings::terminated())
         return false;
@@ -6021,16 +6005,15 @@ bool Tokenizer::simplifyTokenList1(const char FileName[])
     // Change initialisation of variable to assignment
     simplifyInitVar();
 
-    simplifyDoublePlusAndDoubleMinus();
-
-    simplifyArrayAccessSyntax();
+    simplifyPeepholes({
+        {"simplifyDoublePlusAndDoubleMinus", &Tokenizer::simplifyDoublePlusAndDoubleMinus},
+        {"simplifyArrayAccessSyntax", &Tokenizer::simplifyArrayAccessSyntax},
+        {"removeRedundantSemicolons", &Tokenizer::removeRedundantSemicolons},
+        {"simplifyParameterVoid", &Tokenizer::simplifyParameterVoid}
+    });
 
     Token::assignProgressValues(list.front());
 
-    removeRedundantSemicolons();
-
-    simplifyParameterVoid();
-
     simplifyRedundantConsecutiveBraces();
 
     simplifyEmptyNamespaces();
@@ -6041,10 +6024,49 @@ bool Tokenizer::simplifyTokenList1(const char FileName[])
 
     validate();
 
-    list.front()->assignIndexes();
+    list.createTokenIndex();
 
     return true;
 }
+
+void Tokenizer::simplifyPeepholes(std::initializer_list<Peephole> peepholes)
+{
+    const bool showTime = mTimerResults && mSettings.showtime != ShowTime::NONE;
+    std::vector<Timer::Clock::duration> durations(peepholes.size());
+
+    // Last token handled by each handler. The handler is skipped until the sweep has passed it.
+    std::vector<const Token *> handledUntil(peepholes.size());
+
+    for (Token *tok = list.front(); tok; tok = tok->next()) {
+        std::size_t i = 0;
+        for (const Peephole &peephole : peepholes) {
+            if (handledUntil[i]) {
+                if (handledUntil[i] == tok)
+                    handledUntil[i] = nullptr;
+            } else if (showTime) {
+                const Timer::TimePoint start = Timer::Clock::now();
+                const Token *last = (this->*peephole.handler)(tok);
+                durations[i] += Timer::Clock::now() - start;
+                if (last != tok)
+                    handledUntil[i] = last;
+            } else {
+                const Token *last = (this->*peephole.handler)(tok);
+                if (last != tok)
+                    handledUntil[i] = last;
+            }
+            ++i;
+        }
+    }
+
+    if (showTime) {
+        std::size_t i = 0;
+        for (const Peephole &peephole : peepholes) {
+            mTimerResults->addResults(std::string("Tokenizer::simplifyTokens1::simplifyTokenList1::") + peephole.name,
+                                      std::chrono::duration_cast<std::chrono::milliseconds>(durations[i]));
+            ++i;
+        }
+    }
+}
 //---------------------------------------------------------------------------
 
 void Tokenizer::printDebugOutput(std::ostream &out) const
@@ -6806,23 +6828,20 @@ void Tokenizer::simplifyEmptyNamespaces()
     }
 }
 
-void Tokenizer::removeRedundantSemicolons()
+Token* Tokenizer::removeRedundantSemicolons(Token *tok)
 {
-    for (Token *tok = list.front(); tok; tok = tok->next()) {
-        if (tok->link() && tok->str() == "(") {
-            tok = tok->link();
-            continue;
-        }
-        for (;;) {
-            if (Token::simpleMatch(tok, "; ;")) {
-                tok->deleteNext();
-            } else if (Token::simpleMatch(tok, "; { ; }")) {
-                tok->deleteNext(3);
-            } else {
-                break;
-            }
+    if (tok->link() && tok->str() == "(")
+        return tok->link();
+    for (;;) {
+        if (Token::simpleMatch(tok, "; ;")) {
+            tok->deleteNext();
+        } else if (Token::simpleMatch(tok, "; { ; }")) {
+            tok->deleteNext(3);
+        } else {
+            break;
         }
     }
+    return tok;
 }
 
 
@@ -10347,57 +10366,52 @@ void Tokenizer::simplifyNamespaceStd()
 }
 
 
-void Tokenizer::simplifyMicrosoftMemoryFunctions()
+Token* Tokenizer::simplifyMicrosoftMemoryFunctions(Token *tok)
 {
-    // skip if not Windows
-    if (!mSettings.platform.isWindows())
-        return;
-
-    for (Token *tok = list.front(); tok; tok = tok->next()) {
-        if (tok->strAt(1) != "(")
-            continue;
+    if (tok->strAt(1) != "(")
+        return tok;
 
-        if (Token::Match(tok, "CopyMemory|RtlCopyMemory|RtlCopyBytes")) {
-            tok->str("memcpy");
-        } else if (Token::Match(tok, "MoveMemory|RtlMoveMemory")) {
-            tok->str("memmove");
-        } else if (Token::Match(tok, "FillMemory|RtlFillMemory|RtlFillBytes")) {
-            // FillMemory(dst, len, val) -> memset(dst, val, len)
-            tok->str("memset");
+    if (Token::Match(tok, "CopyMemory|RtlCopyMemory|RtlCopyBytes")) {
+        tok->str("memcpy");
+    } else if (Token::Match(tok, "MoveMemory|RtlMoveMemory")) {
+        tok->str("memmove");
+    } else if (Token::Match(tok, "FillMemory|RtlFillMemory|RtlFillBytes")) {
+        // FillMemory(dst, len, val) -> memset(dst, val, len)
+        tok->str("memset");
 
-            Token *tok1 = tok->tokAt(2);
-            if (tok1)
-                tok1 = tok1->nextArgument(); // Second argument
-            if (tok1) {
-                Token *tok2 = tok1->nextArgument(); // Third argument
+        Token *tok1 = tok->tokAt(2);
+        if (tok1)
+            tok1 = tok1->nextArgument(); // Second argument
+        if (tok1) {
+            Token *tok2 = tok1->nextArgument(); // Third argument
 
-                if (tok2)
-                    Token::move(tok1->previous(), tok2->tokAt(-2), tok->linkAt(1)->previous()); // Swap third with second argument
-            }
-        } else if (Token::Match(tok, "ZeroMemory|RtlZeroMemory|RtlZeroBytes|RtlSecureZeroMemory")) {
-            // ZeroMemory(dst, len) -> memset(dst, 0, len)
-            tok->str("memset");
+            if (tok2)
+                Token::move(tok1->previous(), tok2->tokAt(-2), tok->linkAt(1)->previous()); // Swap third with second argument
+        }
+    } else if (Token::Match(tok, "ZeroMemory|RtlZeroMemory|RtlZeroBytes|RtlSecureZeroMemory")) {
+        // ZeroMemory(dst, len) -> memset(dst, 0, len)
+        tok->str("memset");
 
-            Token *tok1 = tok->tokAt(2);
-            if (tok1)
-                tok1 = tok1->nextArgument(); // Second argument
+        Token *tok1 = tok->tokAt(2);
+        if (tok1)
+            tok1 = tok1->nextArgument(); // Second argument
 
-            if (tok1) {
-                tok1 = tok1->previous();
-                tok1->insertToken("0");
-                tok1 = tok1->next();
-                tok1->insertToken(",");
-            }
-        } else if (Token::simpleMatch(tok, "RtlCompareMemory")) {
-            // RtlCompareMemory(src1, src2, len) -> memcmp(src1, src2, len)
-            tok->str("memcmp");
-            // For the record, when memcmp returns 0, both strings are equal.
-            // When RtlCompareMemory returns len, both strings are equal.
-            // It might be needed to improve this replacement by something
-            // like ((len - memcmp(src1, src2, len)) % (len + 1)) to
-            // respect execution path (if required)
+        if (tok1) {
+            tok1 = tok1->previous();
+            tok1->insertToken("0");
+            tok1 = tok1->next();
+            tok1->insertToken(",");
         }
+    } else if (Token::simpleMatch(tok, "RtlCompareMemory")) {
+        // RtlCompareMemory(src1, src2, len) -> memcmp(src1, src2, len)
+        tok->str("memcmp");
+        // For the record, when memcmp returns 0, both strings are equal.
+        // When RtlCompareMemory returns len, both strings are equal.
+        // It might be needed to improve this replacement by something
+        // like ((len - memcmp(src1, src2, len)) % (len + 1)) to
+        // respect execution path (if required)
     }
+    return tok;
 }
 
 namespace {
@@ -10442,39 +10456,34 @@ namespace {
     };
 }
 
-void Tokenizer::simplifyMicrosoftStringFunctions()
+Token* Tokenizer::simplifyMicrosoftStringFunctions(Token *tok)
 {
-    // skip if not Windows
-    if (!mSettings.platform.isWindows())
-        return;
+    if (tok->strAt(1) != "(")
+        return tok;
 
     const bool ansi = (mSettings.platform.type == Platform::Type::Win32A); // TODO: check for UNICODE define instead
-    for (Token *tok = list.front(); tok; tok = tok->next()) {
-        if (tok->strAt(1) != "(")
-            continue;
-
-        const auto match = utils::as_const(apis).find(tok->str());
-        if (match!=apis.end()) {
-            tok->str(ansi ? match->second.mbcs : match->second.unicode);
-            tok->originalName(match->first);
-        } else if (Token::Match(tok, "_T|_TEXT|TEXT ( %char%|%str% )")) {
-            tok->deleteNext();
-            tok->deleteThis();
+    const auto match = utils::as_const(apis).find(tok->str());
+    if (match!=apis.end()) {
+        tok->str(ansi ? match->second.mbcs : match->second.unicode);
+        tok->originalName(match->first);
+    } else if (Token::Match(tok, "_T|_TEXT|TEXT ( %char%|%str% )")) {
+        tok->deleteNext();
+        tok->deleteThis();
+        tok->deleteNext();
+        if (!ansi) {
+            tok->isLong(true);
+            if (tok->str()[0] != 'L')
+                tok->str("L" + tok->str());
+        }
+        while (Token::Match(tok->next(), "_T|_TEXT|TEXT ( %char%|%str% )")) {
+            tok->next()->deleteNext();
+            tok->next()->deleteThis();
+            tok->next()->deleteNext();
+            tok->concatStr(tok->strAt(1));
             tok->deleteNext();
-            if (!ansi) {
-                tok->isLong(true);
-                if (tok->str()[0] != 'L')
-                    tok->str("L" + tok->str());
-            }
-            while (Token::Match(tok->next(), "_T|_TEXT|TEXT ( %char%|%str% )")) {
-                tok->next()->deleteNext();
-                tok->next()->deleteThis();
-                tok->next()->deleteNext();
-                tok->concatStr(tok->strAt(1));
-                tok->deleteNext();
-            }
         }
     }
+    return tok;
 }
 
 // Remove Borland code
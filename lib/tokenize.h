@@ -25,6 +25,7 @@
 #include "tokenlist.h"
 
 #include <cstdint>
+#include <initializer_list>
 #include <iosfwd>
 #include <list>
 #include <map>
@@ -98,6 +99,28 @@ private:
      */
     bool simplifyTokenList1(const char FileName[]);
 
+    /**
+     * Peephole handler, a local simplification that is called for each token.
+     * It may change the given token and the tokens after it but it must not
+     * remove the given token.
+     * @return the last token that has been handled. The handler is not called
+     * again before the sweep is past this token.
+     */
+    using PeepholeHandler = Token* (Tokenizer::*)(Token *tok);
+
+    struct Peephole {
+        const char *name;
+        PeepholeHandler handler;
+    };
+
+    /**
+     * Run peephole handlers together in a single sweep over the token list.
+     * The handlers must be independent of each other, the result must be
+     * the same as when they are run one after another in the given order.
+     * With --showtime the time of each handler is reported.
+     */
+    void simplifyPeepholes(std::initializer_list<Peephole> peepholes);
+
     /**
      * If --check-headers=no has been given; then remove unneeded code in headers.
      * - All executable code.
@@ -261,7 +284,7 @@ private:
     /**
      * Reduces "; ;" to ";", except in "( ; ; )"
      */
-    void removeRedundantSemicolons();
+    Token* removeRedundantSemicolons(Token *tok);
 
     /** Struct simplification
      * "struct S { } s;" => "struct S { }; S s;"
@@ -297,13 +320,13 @@ private:
      */
     void simplifyTemplates();
 
-    void simplifyDoublePlusAndDoubleMinus();
+    Token* simplifyDoublePlusAndDoubleMinus(Token *tok);
 
     void simplifyRedundantConsecutiveBraces();
 
-    void simplifyArrayAccessSyntax();
+    Token* simplifyArrayAccessSyntax(Token *tok);
 
-    void simplifyParameterVoid();
+    Token* simplifyParameterVoid(Token *tok);
 
     void fillTypeSizes();
 
@@ -496,13 +519,13 @@ private:
      * MoveMemory(dst, src, len) -> memmove(dst, src, len)
      * ZeroMemory(dst, len) -> memset(dst, 0, len)
      */
-    void simplifyMicrosoftMemoryFunctions();
+    Token* simplifyMicrosoftMemoryFunctions(Token *tok);
 
     /**
      * Convert Microsoft string functions
      * _tcscpy -> strcpy
      */
-    void simplifyMicrosoftStringFunctions();
+    Token* simplifyMicrosoftStringFunctions(Token *tok);
 
     /**
      * Remove Borland code
@@ -85,6 +85,8 @@ void TokenList::deallocateTokens()
         deleteTokens(mTokensFrontBack->front);
         mTokensFrontBack->front = nullptr;
         mTokensFrontBack->back = nullptr;
+        mTokensFrontBack->tokenIndex.clear();
+        mTokensFrontBack->arena.release();
     }
     // TODO: clear mOrigFiles?
     mFiles.clear();
@@ -119,7 +121,7 @@ void TokenList::deleteTokens(Token *tok)
 {
     while (tok) {
         Token *next = tok->next();
-        delete tok;
+        Token::destroy(tok);
         tok = next;
     }
 }
@@ -151,7 +153,7 @@ void TokenList::addtoken(const std::string& str, const nonneg int lineno, const
     if (mTokensFrontBack->back) {
         mTokensFrontBack->back->insertToken(str);
     } else {
-        mTokensFrontBack->front = new Token(*this, mTokensFrontBack);
+        mTokensFrontBack->front = Token::create(*this, mTokensFrontBack);
         mTokensFrontBack->back = mTokensFrontBack->front;
         mTokensFrontBack->back->str(str);
     }
@@ -169,7 +171,7 @@ void TokenList::addtoken(const std::string& str, const Token *locationTok)
     if (mTokensFrontBack->back) {
         mTokensFrontBack->back->insertToken(str);
     } else {
-        mTokensFrontBack->front = new Token(*this, mTokensFrontBack);
+        mTokensFrontBack->front = Token::create(*this, mTokensFrontBack);
         mTokensFrontBack->back = mTokensFrontBack->front;
         mTokensFrontBack->back->str(str);
     }
@@ -187,7 +189,7 @@ void TokenList::addtoken(const Token * tok, const nonneg int lineno, const nonne
     if (mTokensFrontBack->back) {
         mTokensFrontBack->back->insertToken(tok->str(), tok->originalName());
     } else {
-        mTokensFrontBack->front = new Token(*this, mTokensFrontBack);
+        mTokensFrontBack->front = Token::create(*this, mTokensFrontBack);
         mTokensFrontBack->back = mTokensFrontBack->front;
         mTokensFrontBack->back->str(tok->str());
         if (!tok->originalName().empty())
@@ -208,7 +210,7 @@ void TokenList::addtoken(const Token *tok, const Token *locationTok)
     if (mTokensFrontBack->back) {
         mTokensFrontBack->back->insertToken(tok->str(), tok->originalName());
     } else {
-        mTokensFrontBack->front = new Token(*this, mTokensFrontBack);
+        mTokensFrontBack->front = Token::create(*this, mTokensFrontBack);
         mTokensFrontBack->back = mTokensFrontBack->front;
         mTokensFrontBack->back->str(tok->str());
         if (!tok->originalName().empty())
@@ -229,7 +231,7 @@ void TokenList::addtoken(const Token *tok)
     if (mTokensFrontBack->back) {
         mTokensFrontBack->back->insertToken(tok->str(), tok->originalName(), tok->getMacroName());
     } else {
-        mTokensFrontBack->front = new Token(*this, mTokensFrontBack);
+        mTokensFrontBack->front = Token::create(*this, mTokensFrontBack);
         mTokensFrontBack->back = mTokensFrontBack->front;
         mTokensFrontBack->back->str(tok->str());
         if (!tok->originalName().empty())
@@ -370,7 +372,7 @@ void TokenList::createTokens(simplecpp::TokenList&& tokenList)
         if (mTokensFrontBack->back) {
             mTokensFrontBack->back->insertToken(str);
         } else {
-            mTokensFrontBack->front = new Token(*this, mTokensFrontBack);
+            mTokensFrontBack->front = Token::create(*this, mTokensFrontBack);
             mTokensFrontBack->back = mTokensFrontBack->front;
             mTokensFrontBack->back->str(str);
         }
@@ -2011,6 +2013,25 @@ void TokenList::validateAst(bool print) const
     }
 }
 
+void TokenList::createTokenIndex()
+{
+    std::vector<Token*>& tokens = mTokensFrontBack->tokenIndex;
+    tokens.clear();
+    if (!mTokensFrontBack->front)
+        return;
+    mTokensFrontBack->front->assignIndexes();
+    for (Token *tok = mTokensFrontBack->front; tok; tok = tok->next())
+        tokens.push_back(tok);
+}
+
+const Token *TokenList::tokenAt(nonneg int index) const
+{
+    const std::vector<Token*>& tokens = mTokensFrontBack->tokenIndex;
+    if (index < 1 || static_cast<std::size_t>(index) > tokens.size())
+        return nullptr;
+    return tokens[index - 1];
+}
+
 std::string TokenList::getOrigFile(const Token *tok) const
 {
     return mOrigFiles.at(tok->fileIndex());
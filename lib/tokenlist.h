@@ -22,15 +22,22 @@
 //---------------------------------------------------------------------------
 
 #include "config.h"
+#include "mathlib.h"
 #include "standards.h"
 
 #include <cstddef>
 #include <cstdint>
+#include <list>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 class Token;
+class TokenList;
+namespace ValueFlow {
+    class Value;
+}
 class Settings;
 
 namespace simplecpp {
@@ -40,12 +47,155 @@ namespace simplecpp {
 /// @addtogroup Core
 /// @{
 
+/**
+ * @brief Slab allocator for the tokens of a token list.
+ *
+ * A new Token is placed directly next to its Token::Impl. Tokens that are deleted
+ * by the simplifications are put on free lists and reused, and the memory of the
+ * whole list is released chunk by chunk instead of token by token.
+ */
+class CPPCHECKLIB TokenArena {
+public:
+    TokenArena() = default;
+    ~TokenArena();
+
+    TokenArena(const TokenArena &) = delete;
+    TokenArena &operator=(const TokenArena &) = delete;
+
+    void *allocateToken();
+    void deallocateToken(void *p);
+
+    void *allocateImpl();
+    void deallocateImpl(void *p);
+
+    /** Release all chunks if there are no live allocations */
+    void release();
+
+    /** @return number of allocated chunks */
+    std::size_t chunks() const {
+        return mChunks.size();
+    }
+
+private:
+    struct Slot;
+    struct FreeSlot {
+        FreeSlot *next;
+    };
+
+    Slot *newSlot();
+    static void push(FreeSlot *&list, void *p);
+    static void *pop(FreeSlot *&list);
+
+    std::vector<void *> mChunks;
+    Slot *mCursor{};
+    Slot *mChunkEnd{};
+    FreeSlot *mFreeTokens{};
+    FreeSlot *mFreeImpls{};
+    void *mPendingImpl{};
+    std::size_t mLive{};
+};
+
+/**
+ * @brief Interned token strings of a token list.
+ *
+ * Every distinct token string gets a small id. Tokens of the same list have the same
+ * id if and only if their strings are equal, and the properties that only depend on
+ * the string (keyword, standard type, ..) are determined once per id.
+ */
+class CPPCHECKLIB TokenStrings {
+public:
+    enum : std::uint8_t {
+        fKeyword            = (1 << 0),
+        fControlFlowKeyword = (1 << 1),
+        fStandardType       = (1 << 2),
+        fKnown              = (1 << 7)  // properties have been determined
+    };
+
+    TokenStrings();
+
+    TokenStrings(const TokenStrings &) = delete;
+    TokenStrings &operator=(const TokenStrings &) = delete;
+
+    /** @return id of the given string, a new id is assigned when it is seen the first time */
+    nonneg int intern(const std::string &str);
+
+    const std::string &str(nonneg int id) const {
+        return *mStrings[id];
+    }
+
+    /** @return properties of the string with the given id */
+    std::uint8_t properties(nonneg int id, const TokenList &list);
+
+    /** @return number of distinct strings */
+    std::size_t size() const {
+        return mStrings.size();
+    }
+
+private:
+    std::unordered_map<std::string, nonneg int> mIds;
+    std::vector<const std::string *> mStrings;
+    std::vector<std::uint8_t> mProperties;
+};
+
+/**
+ * @brief Shared ValueFlow value lists of a token list.
+ *
+ * Literals and constant expressions typically get a single known value that has no
+ * dependencies on other tokens. Identical lists of that kind are hash-consed so that
+ * all tokens with the same value share one immutable list.
+ */
+class CPPCHECKLIB TokenValues {
+public:
+    using List = std::list<ValueFlow::Value>;
+
+    TokenValues() = default;
+
+    TokenValues(const TokenValues &) = delete;
+    TokenValues &operator=(const TokenValues &) = delete;
+
+    /** @return true if a list that only contains the given value can be shared */
+    static bool isShareable(const ValueFlow::Value &value);
+
+    /** @return the shared list that only contains the given value, the value must be shareable */
+    std::shared_ptr<List> intern(const ValueFlow::Value &value);
+
+    /** @return number of distinct shared lists */
+    std::size_t size() const {
+        return mLists.size();
+    }
+
+private:
+    struct Key {
+        MathLib::bigint intvalue;
+        MathLib::bigint varvalue;
+        MathLib::bigint wideintvalue;
+        std::uint64_t floatValue;
+        std::uint64_t attributes;
+        nonneg int varId;
+
+        bool operator==(const Key &other) const {
+            return intvalue == other.intvalue && varvalue == other.varvalue && wideintvalue == other.wideintvalue &&
+                   floatValue == other.floatValue && attributes == other.attributes && varId == other.varId;
+        }
+    };
+    struct KeyHash {
+        std::size_t operator()(const Key &key) const;
+    };
+
+    std::unordered_map<Key, std::shared_ptr<List>, KeyHash> mLists;
+};
+
 /**
  * @brief This struct stores pointers to the front and back tokens of the list this token is in.
  */
 struct TokensFrontBack {
     Token *front{};
     Token* back{};
+    /** all tokens ordered by Token::index(), empty if the list has been changed since the index was created */
+    std::vector<Token*> tokenIndex;
+    TokenArena arena;
+    TokenStrings strings;
+    TokenValues values;
 };
 
 class CPPCHECKLIB TokenList {
@@ -144,6 +294,20 @@ public:
         return mFiles;
     }
 
+    /**
+     * Assign Token::index() to all tokens and create the token index.
+     * The index is dropped again when tokens are added, removed or moved.
+     */
+    void createTokenIndex();
+
+    /** @return all tokens ordered by Token::index(), empty if there is no token index */
+    const std::vector<Token*>& tokenIndex() const {
+        return mTokensFrontBack->tokenIndex;
+    }
+
+    /** @return token with the given Token::index() or nullptr if there is no token index */
+    const Token *tokenAt(nonneg int index) const;
+
     std::string getOrigFile(const Token *tok) const;
 
     /**
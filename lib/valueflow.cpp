@@ -789,12 +789,8 @@ static void valueFlowArrayElement(TokenList& tokenlist, const Settings& settings
                 if (arrayValue.valueKind == indexValue.valueKind)
                     result.valueKind = arrayValue.valueKind;
 
-                result.errorPath.insert(result.errorPath.end(),
-                                        arrayValue.errorPath.cbegin(),
-                                        arrayValue.errorPath.cend());
-                result.errorPath.insert(result.errorPath.end(),
-                                        indexValue.errorPath.cbegin(),
-                                        indexValue.errorPath.cend());
+                result.errorPath.append(arrayValue.errorPath);
+                result.errorPath.append(indexValue.errorPath);
 
                 const MathLib::bigint index = indexValue.intvalue;
 
@@ -815,7 +811,7 @@ static void valueFlowArrayElement(TokenList& tokenlist, const Settings& settings
                     const ValueFlow::Value* v = arg->getKnownValue(ValueFlow::Value::ValueType::INT);
                     if (v) {
                         result.intvalue = v->intvalue;
-                        result.errorPath.insert(result.errorPath.end(), v->errorPath.cbegin(), v->errorPath.cend());
+                        result.errorPath.append(v->errorPath);
                         setTokenValue(tok, std::move(result), settings);
                     }
                 }
@@ -915,7 +911,9 @@ static void valueFlowSameExpressions(TokenList& tokenlist, const Settings& setti
         ValueFlow::Value value(val);
         value.setKnown();
 
-        if (isSameExpression(false, tok->astOperand1(), tok->astOperand2(), settings, true, true, &value.errorPath)) {
+        ErrorPath errorPath;
+        if (isSameExpression(false, tok->astOperand1(), tok->astOperand2(), settings, true, true, &errorPath)) {
+            value.errorPath = errorPath;
             setTokenValue(tok, std::move(value), settings);
         }
     }
@@ -1646,7 +1644,7 @@ static std::vector<ValueFlow::LifetimeToken> getLifetimeTokens(const Token* tok,
                     continue;
                 if (v.tokvalue == tok)
                     continue;
-                errorPath.insert(errorPath.end(), v.errorPath.cbegin(), v.errorPath.cend());
+                v.errorPath.appendTo(errorPath);
                 return ValueFlow::LifetimeToken::setAddressOf(
                     getLifetimeTokens(v.tokvalue, escape, std::move(errorPath), pred, settings, depth - 1),
                     false);
@@ -2215,7 +2213,7 @@ struct LifetimeStore {
                     return false;
                 if (!pred(lt.token))
                     return false;
-                ErrorPath er = v.errorPath;
+                ErrorPath er = v.errorPath.toErrorPath();
                 er.insert(er.end(), lt.errorPath.cbegin(), lt.errorPath.cend());
                 er.emplace_back(argtok, message);
                 er.insert(er.end(), errorPath.cbegin(), errorPath.cend());
@@ -2279,7 +2277,7 @@ struct LifetimeStore {
             if (!v.isLifetimeValue())
                 continue;
             const Token *tok2 = v.tokvalue;
-            ErrorPath er = v.errorPath;
+            ErrorPath er = v.errorPath.toErrorPath();
             const Variable *var = ValueFlow::getLifetimeVariable(tok2, er, settings);
             // TODO: the inserted data is never used
             er.insert(er.end(), errorPath.cbegin(), errorPath.cend());
@@ -2539,7 +2537,7 @@ static void valueFlowLifetimeFunction(Token *tok, const TokenList &tokenlist, Er
                                                      ValueFlow::Value::LifetimeKind::Object};
                     ls.inconclusive = inconclusive;
                     ls.forward = false;
-                    ls.errorPath = v.errorPath;
+                    ls.errorPath = v.errorPath.toErrorPath();
                     ls.errorPath.emplace_front(returnTok, "Return " + lifetimeType(returnTok, &v) + ".");
                     int thisIndirect = v.lifetimeScope == ValueFlow::Value::LifetimeScope::ThisValue ? 0 : 1;
                     if (derefShared(memtok->astParent()))
@@ -2558,7 +2556,7 @@ static void valueFlowLifetimeFunction(Token *tok, const TokenList &tokenlist, Er
                     continue;
                 ls.forward = false;
                 ls.inconclusive = inconclusive;
-                ls.errorPath = v.errorPath;
+                ls.errorPath = v.errorPath.toErrorPath();
                 ls.errorPath.emplace_front(returnTok, "Return " + lifetimeType(returnTok, &v) + ".");
                 if (!v.isArgumentLifetimeValue() && (var->isReference() || var->isRValueReference())) {
                     update |= ls.byRef(tok->next(), tokenlist, errorLogger, settings);
@@ -3096,7 +3094,9 @@ static void valueFlowLifetime(TokenList &tokenlist, ErrorLogger &errorLogger, co
                 for (const ReferenceToken& rt : tok2->refs(false)) {
                     ValueFlow::Value value = master;
                     value.tokvalue = rt.token;
-                    value.errorPath.insert(value.errorPath.begin(), rt.errors.cbegin(), rt.errors.cend());
+                    ErrorPath errorPath = rt.errors;
+                    value.errorPath.appendTo(errorPath);
+                    value.errorPath = errorPath;
                     if (Token::simpleMatch(parent, "("))
                         setTokenValue(parent, std::move(value), settings);
                     else
@@ -3816,7 +3816,7 @@ static void valueFlowForwardConst(Token* start,
                     for (ValueFlow::Value value : values) {
                         if (refs.size() > 1)
                             value.setInconclusive();
-                        value.errorPath.insert(value.errorPath.end(), it->errors.cbegin(), it->errors.cend());
+                        value.errorPath.append(it->errors);
                         setTokenValue(tok, std::move(value), settings);
                     }
                     return;
@@ -3840,7 +3840,7 @@ static void valueFlowForwardConst(Token* start,
                         if (!value.isImpossible())
                             value.valueKind = v.valueKind;
                         value.bound = v.bound;
-                        value.errorPath.insert(value.errorPath.end(), v.errorPath.cbegin(), v.errorPath.cend());
+                        value.errorPath.append(v.errorPath);
                         setTokenValue(tok, std::move(value), settings);
                     }
                 }
@@ -5890,20 +5890,14 @@ static bool needsInitialization(const Variable* var)
 static void addToErrorPath(ValueFlow::Value& value, const ValueFlow::Value& from)
 {
     std::unordered_set<const Token*> locations;
-    std::transform(value.errorPath.cbegin(),
-                   value.errorPath.cend(),
-                   std::inserter(locations, locations.begin()),
-                   [](const ErrorPathItem& e) {
-        return e.first;
-    });
+    for (const ErrorPathItem& e : value.errorPath.toErrorPath())
+        locations.insert(e.first);
     if (from.condition && !value.condition)
         value.condition = from.condition;
-    std::copy_if(from.errorPath.cbegin(),
-                 from.errorPath.cend(),
-                 std::back_inserter(value.errorPath),
-                 [&](const ErrorPathItem& e) {
-        return locations.insert(e.first).second;
-    });
+    for (const ErrorPathItem& e : from.errorPath.toErrorPath()) {
+        if (locations.insert(e.first).second)
+            value.errorPath.emplace_back(e.first, e.second);
+    }
 }
 
 static std::vector<Token*> findAllUsages(const Variable* var,
@@ -6033,7 +6027,7 @@ static void valueFlowUninit(TokenList& tokenlist, ErrorLogger& errorLogger, cons
                             continue;
                         addToErrorPath(v2, v);
                     }
-                    v2.subexpressions.push_back(memVar.nameToken()->str());
+                    v2.addSubexpression(memVar.nameToken()->str());
                 }
             }
         }
@@ -7133,8 +7127,8 @@ static void valueFlowDebug(TokenList& tokenlist, ErrorLogger& errorLogger, const
             continue;
         for (const ValueFlow::Value& v : tok->values()) {
             std::string msg = "The value is " + debugString(v);
-            ErrorPath errorPath = v.errorPath;
-            errorPath.insert(errorPath.end(), v.debugPath.cbegin(), v.debugPath.cend());
+            ErrorPath errorPath = v.errorPath.toErrorPath();
+            errorPath.insert(errorPath.end(), v.debugPath().cbegin(), v.debugPath().cend());
             errorPath.emplace_back(tok, "");
             errorLogger.reportErr({std::move(errorPath), &tokenlist, Severity::debug, "valueFlow", msg, CWE{0}, Certainty::normal});
         }
@@ -383,7 +383,7 @@ namespace ValueFlow
             return;
         std::string s = Path::stripDirectoryPart(file) + ":" + std::to_string(ctx.line()) + ": " + ctx.function_name() +
                         " => " + local.function_name() + ": " + debugString(v);
-        v.debugPath.emplace_back(tok, std::move(s));
+        v.addDebugPath(tok, std::move(s));
     }
 
     MathLib::bigint valueFlowGetStrLength(const Token* tok)
@@ -347,9 +347,9 @@ namespace ValueFlow
                 return;
             }
             Value pvalue = value;
-            if (!value.subexpressions.empty() && Token::Match(parent, ". %var%")) {
-                if (contains(value.subexpressions, parent->strAt(1)))
-                    pvalue.subexpressions.clear();
+            if (!value.subexpressions().empty() && Token::Match(parent, ". %var%")) {
+                if (contains(value.subexpressions(), parent->strAt(1)))
+                    pvalue.clearSubexpressions();
                 else
                     return;
             }
@@ -22,9 +22,15 @@
 #include "token.h"
 #include "utils.h"
 
+#include <memory>
 #include <sstream>
 #include <string>
 
+#if !defined(HAVE_BOOST_INT128) && !defined(_GLIBCXX_DEBUG) && !(defined(_ITERATOR_DEBUG_LEVEL) && _ITERATOR_DEBUG_LEVEL > 0)
+// Values are copied a lot during the analysis, don't let the size grow unnoticed
+static_assert(sizeof(void *) != 8 || sizeof(ValueFlow::Value) <= 120, "ValueFlow::Value has grown");
+#endif
+
 namespace ValueFlow {
     Value::Value(const Token *c, MathLib::bigint val, Bound b)
         : bound(b),
@@ -160,6 +166,19 @@ namespace ValueFlow {
         return "";
     }
 
+    const Value::Extra& Value::emptyExtra() {
+        static const Extra empty;
+        return empty;
+    }
+
+    Value::Extra& Value::extra() {
+        if (!mExtra)
+            mExtra = std::make_shared<Extra>();
+        else if (mExtra.use_count() > 1)
+            mExtra = std::make_shared<Extra>(*mExtra);
+        return *mExtra;
+    }
+
     bool Value::sameToken(const Token *tok1, const Token *tok2) {
         if (tok1 == tok2)
             return true;
@@ -29,6 +29,7 @@
 #include <cmath>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <utility>
@@ -331,9 +332,27 @@ namespace ValueFlow
         /** Condition that this value depends on */
         const Token* condition{};
 
-        ErrorPath errorPath;
+        SharedErrorPath errorPath;
 
-        ErrorPath debugPath; // TODO: make lighter by default
+        /** Debug path, only recorded with --debug */
+        const ErrorPath& debugPath() const {
+            return mExtra ? mExtra->debugPath : emptyExtra().debugPath;
+        }
+        void addDebugPath(const Token* tok, std::string s) {
+            extra().debugPath.emplace_back(tok, std::move(s));
+        }
+
+        /** Uninitialized member variables */
+        const std::vector<std::string>& subexpressions() const {
+            return mExtra ? mExtra->subexpressions : emptyExtra().subexpressions;
+        }
+        void addSubexpression(std::string s) {
+            extra().subexpressions.push_back(std::move(s));
+        }
+        void clearSubexpressions() {
+            if (mExtra && !mExtra->subexpressions.empty())
+                extra().subexpressions.clear();
+        }
 
         /** For calculated values - varId that calculated value depends on */
         nonneg int varId{};
@@ -354,8 +373,6 @@ namespace ValueFlow
         /** int value before implicit truncation */
         MathLib::bigint wideintvalue{};
 
-        std::vector<std::string> subexpressions;
-
         // Set to where a lifetime is captured by value
         const Token* capturetok{};
 
@@ -409,6 +426,16 @@ namespace ValueFlow
         static bool sameToken(const Token* tok1, const Token* tok2);
 
     private:
+        /** Rarely used data, shared between the copies of a value */
+        struct Extra {
+            ErrorPath debugPath;
+            std::vector<std::string> subexpressions;
+        };
+        std::shared_ptr<Extra> mExtra;
+
+        static const Extra& emptyExtra();
+        Extra& extra();
+
         struct equalVisitor {
             template<class T, class U>
             void operator()(bool& result, T x, U y) const {
@@ -155,6 +155,9 @@ private:
         TEST_CASE(debugwarnings);
         TEST_CASE(forceshort);
         TEST_CASE(forcelong);
+        TEST_CASE(headerCache);
+        TEST_CASE(headerCacheInvalid);
+        TEST_CASE(headerCacheNegative);
         TEST_CASE(relativePaths1);
         TEST_CASE(relativePaths2);
         TEST_CASE(relativePaths3);
@@ -742,6 +745,27 @@ private:
         ASSERT_EQUALS(true, settings->force);
     }
 
+    void headerCache() {
+        REDIRECT;
+        const char * const argv[] = {"cppcheck", "--header-cache=256", "file.cpp"};
+        ASSERT_EQUALS_ENUM(CmdLineParser::Result::Success, parseFromArgs(argv));
+        ASSERT_EQUALS(256, settings->headerCacheSize);
+    }
+
+    void headerCacheInvalid() {
+        REDIRECT;
+        const char * const argv[] = {"cppcheck", "--header-cache=one", "file.cpp"};
+        ASSERT_EQUALS_ENUM(CmdLineParser::Result::Fail, parseFromArgs(argv));
+        ASSERT_EQUALS("cppcheck: error: argument to '--header-cache=' is not valid - not an integer.\n", logger->str());
+    }
+
+    void headerCacheNegative() {
+        REDIRECT;
+        const char * const argv[] = {"cppcheck", "--header-cache=-1", "file.cpp"};
+        ASSERT_EQUALS_ENUM(CmdLineParser::Result::Fail, parseFromArgs(argv));
+        ASSERT_EQUALS("cppcheck: error: argument to '--header-cache=' needs to be a positive integer.\n", logger->str());
+    }
+
     void relativePaths1() {
         REDIRECT;
         const char * const argv[] = {"cppcheck", "-rp", "file.cpp"};
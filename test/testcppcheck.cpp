@@ -34,8 +34,10 @@
 #include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <functional>
 #include <list>
 #include <string>
+#include <thread>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -84,6 +86,8 @@ private:
         TEST_CASE(checkPlistOutput);
         TEST_CASE(premiumResultsCache);
         TEST_CASE(purgedConfiguration);
+        TEST_CASE(purgedConfigurationPreprocessed);
+        TEST_CASE(scheduleConfigs);
     }
 
     void getErrorMessages() const {
@@ -622,6 +626,84 @@ private:
                       it->toString(false, templateFormat, ""));
     }
 
+    void purgedConfigurationPreprocessed() const
+    {
+        ScopedFile test_file("test_pp.cpp",
+                             "#ifdef X\n"
+                             "#endif\n"
+                             "void f() { (\n");
+
+        // this is the "simple" format
+        const auto s = dinit(Settings,
+                             $.templateFormat = templateFormat, // TODO: remove when we only longer rely on toString() in unique message handling
+                                 $.severity.enable (Severity::information);
+                             $.debugwarnings = true);
+        Suppressions supprs;
+        ErrorLogger2 errorLogger;
+        CppCheck cppcheck(s, supprs, errorLogger, nullptr, false, {});
+        ASSERT_EQUALS(1, cppcheck.check(FileWithDetails(test_file.path(), Path::identify(test_file.path(), false), 0)));
+        // TODO: how to properly disable these warnings?
+        errorLogger.errmsgs.erase(std::remove_if(errorLogger.errmsgs.begin(), errorLogger.errmsgs.end(), [](const ErrorMessage& msg) {
+            return msg.id == "logChecker";
+        }), errorLogger.errmsgs.end());
+        // the duplicated configuration is skipped before it is simplified so the syntax error is only reported once
+        ASSERT_EQUALS(2, errorLogger.errmsgs.size());
+        auto it = errorLogger.errmsgs.cbegin();
+        ASSERT_EQUALS("test_pp.cpp:3:10: error: Unmatched '{'. Configuration: ''. [syntaxError]",
+                      it->toString(false, templateFormat, ""));
+        ++it;
+        ASSERT_EQUALS("test_pp.cpp:0:0: information: The configuration 'X=X' was not checked because its code equals another one. [purgedConfiguration]",
+                      it->toString(false, templateFormat, ""));
+    }
+
+    void scheduleConfigs() const
+    {
+        ScopedFile test_file("schedule.c",
+                             "#ifdef A\n"
+                             "void a() { (void)(*((int*)0)); }\n"
+                             "#endif\n"
+                             "#ifdef B\n"
+                             "void b() { (\n"
+                             "#endif\n"
+                             "#ifdef C\n"
+                             "void c() { (void)(*((int*)0)); }\n"
+                             "#endif\n");
+
+        const auto s = dinit(Settings, $.templateFormat = templateFormat);
+        // the scheduled tasks are either executed by other threads or not at all
+        for (const bool execute : {
+            true, false
+        }) {
+            Suppressions supprs;
+            ErrorLogger2 errorLogger;
+            std::vector<std::thread> threads;
+            {
+                CppCheck cppcheck(s, supprs, errorLogger, nullptr, false, {});
+                cppcheck.setScheduleTask([&](std::function<void()> task) {
+                    if (execute)
+                        threads.emplace_back(std::move(task));
+                    return true;
+                });
+                ASSERT_EQUALS(1, cppcheck.check(FileWithDetails(test_file.path(), Path::identify(test_file.path(), false), 0)));
+            }
+            for (std::thread &t : threads)
+                t.join();
+            ASSERT_EQUALS(execute ? 3 : 0, threads.size());
+            // TODO: how to properly disable these warnings?
+            errorLogger.errmsgs.erase(std::remove_if(errorLogger.errmsgs.begin(), errorLogger.errmsgs.end(), [](const ErrorMessage& msg) {
+                return msg.id == "logChecker";
+            }), errorLogger.errmsgs.end());
+            // the messages are in the order of the configurations
+            std::string errout;
+            for (const ErrorMessage &msg : errorLogger.errmsgs)
+                errout += msg.toString(false, templateFormat, "") + '\n';
+            ASSERT_EQUALS("schedule.c:2:21: error: Null pointer dereference: (int*)0 [nullPointer]\n"
+                          "schedule.c:5:10: error: Unmatched '{'. Configuration: 'B=B'. [syntaxError]\n"
+                          "schedule.c:8:21: error: Null pointer dereference: (int*)0 [nullPointer]\n",
+                          errout);
+        }
+    }
+
     // TODO: test suppressions
     // TODO: test all with FS
 };
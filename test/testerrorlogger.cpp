@@ -24,6 +24,7 @@
 #include "helpers.h"
 #include "suppressions.h"
 
+#include <iterator>
 #include <list>
 #include <string>
 #include <utility>
@@ -77,6 +78,8 @@ private:
 
         TEST_CASE(isCriticalErrorId);
 
+        TEST_CASE(sharedErrorPath);
+
         TEST_CASE(TestReportType);
     }
 
@@ -732,6 +735,34 @@ private:
         // It does not abort all the analysis of the file. Like "missingInclude" there can be false negatives.
         ASSERT_EQUALS(false, ErrorLogger::isCriticalErrorId("misra-config"));
     }
+
+    void sharedErrorPath() const {
+        SharedErrorPath path1;
+        ASSERT_EQUALS(true, path1.empty());
+        path1.emplace_back(nullptr, "a");
+        path1.emplace_back(nullptr, "b");
+
+        SharedErrorPath path2 = path1;
+        path2.emplace_back(nullptr, "c");
+        ASSERT_EQUALS(2, path1.size());
+        ASSERT_EQUALS(3, path2.size());
+        ASSERT_EQUALS("b", path1.back().second);
+        ASSERT_EQUALS("c", path2.back().second);
+
+        ErrorPath errorPath{ErrorPathItem(nullptr, "x")};
+        path2.appendTo(errorPath);
+        ASSERT_EQUALS(4, errorPath.size());
+        ASSERT_EQUALS("x", errorPath.front().second);
+        ASSERT_EQUALS("a", std::next(errorPath.cbegin())->second);
+        ASSERT_EQUALS("c", errorPath.back().second);
+
+        SharedErrorPath path3;
+        path3.append(path2);
+        path3.append(path1);
+        ASSERT_EQUALS(5, path3.size());
+        ASSERT_EQUALS("b", path3.back().second);
+        ASSERT_EQUALS(3, path2.size());
+    }
 };
 
 REGISTER_TEST(TestErrorLogger)
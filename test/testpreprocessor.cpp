@@ -32,10 +32,15 @@
 #include "fixture.h"
 #include "helpers.h"
 
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
+#include <iterator>
 #include <list>
 #include <map>
 #include <set>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <utility>
@@ -325,6 +330,7 @@ private:
         TEST_CASE(getConfigsError);
 
         TEST_CASE(getConfigsD1);
+        TEST_CASE(getConfigsD2);
 
         TEST_CASE(getConfigsU1);
         TEST_CASE(getConfigsU2);
@@ -370,6 +376,19 @@ private:
         TEST_CASE(writeLocations);
 
         TEST_CASE(pragmaAsm);
+
+        TEST_CASE(headerCache);
+        TEST_CASE(headerCacheChanged);
+        TEST_CASE(headerCacheEvict);
+        TEST_CASE(headerCacheOutput);
+        TEST_CASE(headerCachePreprocess);
+        TEST_CASE(headerCacheBuildDir);
+
+        TEST_CASE(macroExpansionCache);
+        TEST_CASE(includeGuard);
+        TEST_CASE(includeDirectoryCache);
+        TEST_CASE(macroStateCache);
+        TEST_CASE(bulkLexer);
     }
 
     template<size_t size>
@@ -2350,6 +2369,20 @@ private:
         ASSERT_EQUALS("\nX=X\nY=Y\n", getConfigsStr(filedata));
     }
 
+    void getConfigsD2() {
+        const char filedata[] = "#ifdef B\n"
+                                "#ifdef A\n"
+                                "#ifdef B\n"
+                                "#endif\n"
+                                "#endif\n"
+                                "#endif\n"
+                                "#ifdef A\n"
+                                "#endif\n";
+        ASSERT_EQUALS("\nA=A\nA=A;B=B\nB=B\n", getConfigsStr(filedata));
+        ASSERT_EQUALS("\nB=B\n", getConfigsStr(filedata, "-DA"));
+        ASSERT_EQUALS("\nA=A\nA=A;B=B\nB=B\n", getConfigsStr(filedata, "-DAB"));
+    }
+
     void getConfigsU1() {
         const char filedata[] = "#ifdef X\n"
                                 "#endif\n";
@@ -2862,6 +2895,450 @@ private:
         const char code[] = "#pragma asm";
         ASSERT_THROW_INTERNAL(getcodeforcfg(settingsDefault, *this, code, "", "test.cpp"), InternalError::SYNTAX);
     }
+
+    void headerCache()
+    {
+        ScopedFile header("cached.h", "#define A 1\nint a = A;\n");
+        HeaderCache cache(1024 * 1024);
+        simplecpp::OutputList outputList;
+
+        std::vector<std::string> files1{"test.c"};
+        const simplecpp::TokenList tokens1 = cache.load(header.path(), files1, &outputList);
+        ASSERT_EQUALS(1, cache.count());
+        ASSERT(cache.size() > 0);
+
+        std::vector<std::string> files2{"other.c", "other.h"};
+        const simplecpp::TokenList tokens2 = cache.load(header.path(), files2, &outputList);
+        ASSERT_EQUALS(1, cache.count());
+        ASSERT_EQUALS(tokens1.stringify(true), tokens2.stringify(true));
+        ASSERT_EQUALS(3, files2.size());
+        ASSERT_EQUALS(header.path(), files2[2]);
+        ASSERT_EQUALS(2, tokens2.cfront()->location.fileIndex);
+
+        // same tokens as reading the file
+        std::vector<std::string> files3{"test.c"};
+        const simplecpp::TokenList tokens3(header.path(), files3, &outputList);
+        ASSERT_EQUALS(tokens3.stringify(true), tokens2.stringify(true));
+        ASSERT_EQUALS(0, outputList.size());
+
+        // missing file
+        std::vector<std::string> files4{"test.c"};
+        const simplecpp::TokenList tokens4 = cache.load("missing.h", files4, &outputList);
+        ASSERT(tokens4.empty());
+        ASSERT_EQUALS(1, outputList.size());
+        ASSERT_EQUALS_ENUM(simplecpp::Output::FILE_NOT_FOUND, outputList.front().type);
+        ASSERT_EQUALS(1, cache.count());
+    }
+
+    void headerCacheChanged()
+    {
+        ScopedFile header("cached.h", "int a;\n");
+        HeaderCache cache(1024 * 1024);
+
+        std::vector<std::string> files;
+        ASSERT_EQUALS("int a ;", cache.load(header.path(), files, nullptr).stringify());
+        {
+            std::ofstream fout(header.path());
+            fout << "int b;\n";
+        }
+        ASSERT_EQUALS("int b ;", cache.load(header.path(), files, nullptr).stringify());
+        ASSERT_EQUALS(1, cache.count());
+    }
+
+    void headerCacheEvict()
+    {
+        ScopedFile header1("cached1.h", "int a;\n");
+        ScopedFile header2("cached2.h", "int b;\n");
+        HeaderCache cache(1024 * 1024);
+
+        std::vector<std::string> files;
+        (void)cache.load(header1.path(), files, nullptr);
+        const std::size_t size1 = cache.size();
+        (void)cache.load(header2.path(), files, nullptr);
+        ASSERT_EQUALS(2, cache.count());
+
+        // the least recently used header is dropped
+        (void)cache.load(header1.path(), files, nullptr);
+        cache.setMaxSize(size1);
+        ASSERT_EQUALS(1, cache.count());
+        ASSERT_EQUALS(size1, cache.size());
+        (void)cache.load(header1.path(), files, nullptr);
+        ASSERT_EQUALS(size1, cache.size());
+
+        // headers larger than the limit are not cached
+        cache.setMaxSize(0);
+        ASSERT_EQUALS(0, cache.count());
+        ASSERT_EQUALS("int a ;", cache.load(header1.path(), files, nullptr).stringify());
+        ASSERT_EQUALS(0, cache.count());
+    }
+
+    void headerCacheOutput()
+    {
+        ScopedFile header("cached.h", "#define A 1 \\ \n  + 2\n");
+        HeaderCache cache(1024 * 1024);
+
+        for (int i = 0; i < 2; ++i) {
+            std::vector<std::string> files{"test.c"};
+            simplecpp::OutputList outputList;
+            (void)cache.load(header.path(), files, &outputList);
+            ASSERT_EQUALS(1, outputList.size());
+            ASSERT_EQUALS_ENUM(simplecpp::Output::PORTABILITY_BACKSLASH, outputList.front().type);
+            ASSERT_EQUALS(1, outputList.front().location.fileIndex);
+            ASSERT_EQUALS(1, outputList.front().location.line);
+        }
+    }
+
+    static std::string readFile(const std::string &path)
+    {
+        std::ifstream fin(path, std::ios::in | std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+    }
+
+    static void writeFile(const std::string &path, const std::string &data)
+    {
+        std::ofstream fout(path, std::ios::out | std::ios::binary);
+        fout << data;
+    }
+
+    void headerCacheBuildDir()
+    {
+        ScopedFile header("cached.h", "#define A 1 \\ \n  + 2\nint a = A;\n", "headercache");
+        const std::string cacheFile = HeaderCache::getCacheFile("headercache", header.path());
+
+        std::vector<std::string> files1;
+        simplecpp::OutputList outputList1;
+        const simplecpp::TokenList tokens1(header.path(), files1, &outputList1);
+        ASSERT_EQUALS(1, outputList1.size());
+
+        const auto load = [&](std::string &str, std::size_t &outputs) {
+            HeaderCache cache(0);
+            cache.setBuildDir("headercache");
+            std::vector<std::string> files;
+            simplecpp::OutputList outputList;
+            str = cache.load(header.path(), files, &outputList).stringify();
+            outputs = outputList.size();
+            ASSERT_EQUALS(files1.size(), files.size());
+        };
+        std::string str;
+        std::size_t outputs = 0;
+
+        // the tokens are stored in the build dir
+        load(str, outputs);
+        ASSERT_EQUALS(tokens1.stringify(), str);
+        ASSERT_EQUALS(1, outputs);
+        std::string cached = readFile(cacheFile);
+        ASSERT(cached.find("int") != std::string::npos);
+
+        // and loaded from there by other caches
+        cached.replace(cached.find("int"), 3, "INT");
+        writeFile(cacheFile, cached);
+        load(str, outputs);
+        ASSERT(str.find("INT a = A ;") != std::string::npos);
+        ASSERT_EQUALS(1, outputs);
+
+        // a broken file is written again
+        writeFile(cacheFile, cached.substr(0, cached.size() - 1));
+        load(str, outputs);
+        ASSERT_EQUALS(tokens1.stringify(), str);
+        ASSERT(readFile(cacheFile).find("int") != std::string::npos);
+
+        // the file is written again when the header has been changed
+        writeFile(header.path(), "long b;\n");
+        load(str, outputs);
+        ASSERT_EQUALS("long b ;", str);
+        ASSERT_EQUALS(0, outputs);
+        ASSERT(readFile(cacheFile).find("long") != std::string::npos);
+
+        std::remove(cacheFile.c_str());
+    }
+
+    void headerCachePreprocess()
+    {
+        const char inc[] = "class A {\n"
+                           "public:\n"
+                           "    void f() {}\n"
+                           "};";
+        const char code[] = R"(#include "test.h")";
+        ScopedFile header("test.h", inc);
+        const auto settings = dinit(Settings, $.headerCacheSize = 1);
+        for (int i = 0; i < 2; ++i) {
+            const std::string processed = getcodeforcfg(settings, *this, code, "", "test.cpp");
+            ASSERT_EQUALS(
+                "\n"
+                "#line 1 \"test.h\"\n"
+                "class A {\n"
+                "public :\n"
+                "void f ( ) { }\n"
+                "} ;",
+                processed);
+        }
+    }
+
+    template<size_t size>
+    std::string preprocessWithStats(const char (&code)[size], simplecpp::MacroExpansionStats &stats, std::list<simplecpp::MacroUsage> *macroUsage = nullptr)
+    {
+        std::vector<std::string> files;
+        const simplecpp::TokenList tokens1(code, files, "test.c");
+        simplecpp::TokenList tokens2(files);
+        simplecpp::FileDataCache cache;
+        simplecpp::OutputList outputList;
+        simplecpp::preprocess(tokens2, tokens1, files, cache, simplecpp::DUI(), &outputList, macroUsage, nullptr, &stats);
+        ASSERT(outputList.empty());
+        return tokens2.stringify();
+    }
+
+    void macroExpansionCache()
+    {
+        {
+            const char code[] = "#define LOG(x) log(#x, x)\n"
+                                "LOG(1); LOG(1); LOG(2);\n"
+                                "LOG(1);\n"
+                                "#define X\n"
+                                "LOG(1);\n";
+            simplecpp::MacroExpansionStats stats;
+            std::list<simplecpp::MacroUsage> macroUsage;
+            ASSERT_EQUALS("\nlog ( \"1\" , 1 ) ; log ( \"1\" , 1 ) ; log ( \"2\" , 2 ) ;\n"
+                          "log ( \"1\" , 1 ) ;\n"
+                          "\n"
+                          "log ( \"1\" , 1 ) ;",
+                          preprocessWithStats(code, stats, &macroUsage));
+            ASSERT_EQUALS(2, stats.hits);
+            ASSERT_EQUALS(3, stats.misses); // the cache is cleared by #define
+            ASSERT_EQUALS(0, stats.uncached);
+            // the usage is recorded for cached expansions as well
+            ASSERT_EQUALS(5, macroUsage.size());
+            ASSERT(std::any_of(macroUsage.cbegin(), macroUsage.cend(), [](const simplecpp::MacroUsage &mu) {
+                return mu.useLocation.line == 3 && mu.useLocation.col == 1;
+            }));
+        }
+        {
+            // a redefined macro is not expanded from the cache
+            const char code[] = "#define A(x) x\n"
+                                "A(1);\n"
+                                "#define A(x) -x\n"
+                                "A(1);\n";
+            simplecpp::MacroExpansionStats stats;
+            ASSERT_EQUALS("\n1 ;\n\n- 1 ;", preprocessWithStats(code, stats));
+            ASSERT_EQUALS(0, stats.hits);
+        }
+        {
+            // the expansion depends on the location
+            const char code[] = "#define L __LINE__\n"
+                                "L\n"
+                                "L\n";
+            simplecpp::MacroExpansionStats stats;
+            ASSERT_EQUALS("\n2\n3", preprocessWithStats(code, stats));
+            ASSERT_EQUALS(0, stats.hits);
+            ASSERT_EQUALS(2, stats.uncached);
+        }
+        {
+            // the expansion continues with the tokens after the call
+            const char code[] = "#define F(x) x\n"
+                                "#define G F\n"
+                                "G(1) G(2) G\n";
+            simplecpp::MacroExpansionStats stats;
+            ASSERT_EQUALS("\n\n1 2 F", preprocessWithStats(code, stats));
+            ASSERT_EQUALS(0, stats.hits);
+        }
+    }
+
+    void includeGuard()
+    {
+        ScopedFile guarded("guarded.h",
+                           "// comment\n"
+                           "#ifndef GUARDED_H\n"
+                           "#define GUARDED_H\n"
+                           "#if A\n"
+                           "#else\n"
+                           "#endif\n"
+                           "int a;\n"
+                           "#endif // GUARDED_H\n");
+        ScopedFile unguarded("unguarded.h",
+                             "#ifndef UNGUARDED_H\n"
+                             "#define UNGUARDED_H\n"
+                             "int b;\n"
+                             "#else\n"
+                             "int c;\n"
+                             "#endif\n");
+        const char code[] = "#include \"guarded.h\"\n"
+                            "#include \"guarded.h\"\n"
+                            "#include \"unguarded.h\"\n"
+                            "#include \"unguarded.h\"\n";
+        std::vector<std::string> files;
+        const simplecpp::TokenList tokens1(code, files, "test.c");
+        simplecpp::FileDataCache cache;
+        simplecpp::TokenList tokens2(files);
+        std::list<simplecpp::MacroUsage> macroUsage;
+        simplecpp::preprocess(tokens2, tokens1, files, cache, simplecpp::DUI(), nullptr, &macroUsage);
+        ASSERT_EQUALS("\n#line 7 \"guarded.h\"\nint a ;\n#line 3 \"unguarded.h\"\nint b ;\n\nint c ;", tokens2.stringify());
+
+        ASSERT_EQUALS(2, cache.size());
+        for (const auto &filedata : cache) {
+            ASSERT(filedata->includeGuardChecked);
+            if (filedata->filename.find("unguarded.h") != std::string::npos) {
+                ASSERT_EQUALS("", filedata->includeGuard);
+            } else {
+                ASSERT_EQUALS("GUARDED_H", filedata->includeGuard);
+                ASSERT_EQUALS(2, filedata->includeGuardLocation.line);
+            }
+        }
+
+        // the guard is still reported as used by the skipped include
+        ASSERT_EQUALS(4, macroUsage.size());
+    }
+
+    void includeDirectoryCache()
+    {
+        const char code[] = "#include \"late.h\"\n";
+        simplecpp::DUI dui;
+        dui.includePaths.emplace_back("missing");
+        dui.includePaths.emplace_back("inc");
+
+        {
+            std::vector<std::string> files;
+            const simplecpp::TokenList tokens1(code, files, "test.c");
+            simplecpp::FileDataCache cache;
+            simplecpp::TokenList tokens2(files);
+            simplecpp::OutputList outputList;
+            simplecpp::preprocess(tokens2, tokens1, files, cache, dui, &outputList);
+            ASSERT_EQUALS(1, outputList.size());
+            ASSERT_EQUALS_ENUM(simplecpp::Output::MISSING_HEADER, outputList.front().type);
+            ASSERT_EQUALS(0, cache.size());
+        }
+
+        // a header which is created after a failed lookup is found by the next preprocessing
+        ScopedFile header("late.h", "int late;\n", "inc");
+        {
+            std::vector<std::string> files;
+            const simplecpp::TokenList tokens1(code, files, "test.c");
+            simplecpp::FileDataCache cache;
+            simplecpp::TokenList tokens2(files);
+            simplecpp::OutputList outputList;
+            simplecpp::preprocess(tokens2, tokens1, files, cache, dui, &outputList);
+            ASSERT_EQUALS(0, outputList.size());
+            ASSERT_EQUALS("\n#line 1 \"inc/late.h\"\nint late ;", tokens2.stringify());
+        }
+    }
+
+    template<size_t size>
+    std::string preprocessWithMacroState(const char (&code)[size], const char *filename, const simplecpp::DUI &dui, simplecpp::MacroStateCache &macroStateCache, std::list<simplecpp::MacroUsage> &macroUsage, std::list<simplecpp::IfCond> &ifCond)
+    {
+        std::vector<std::string> files;
+        const simplecpp::TokenList tokens1(code, files, filename);
+        simplecpp::TokenList tokens2(files);
+        simplecpp::FileDataCache cache;
+        simplecpp::OutputList outputList;
+        simplecpp::preprocess(tokens2, tokens1, files, cache, dui, &outputList, &macroUsage, &ifCond, nullptr, &macroStateCache);
+        ASSERT(outputList.empty());
+        return tokens2.stringify();
+    }
+
+    void macroStateCache()
+    {
+        const char code[] = "#if A\n"
+                            "int x = A + B(1);\n"
+                            "#endif\n";
+        simplecpp::DUI dui;
+        dui.includes.emplace_back("forced.h");
+        simplecpp::MacroStateCache macroStateCache;
+
+        {
+            ScopedFile forced("forced.h",
+                              "#define A 1\n"
+                              "#define B(x) (x + A)\n"
+                              "#if A\n"
+                              "int a;\n"
+                              "#endif\n");
+
+            std::list<simplecpp::MacroUsage> macroUsage1;
+            std::list<simplecpp::IfCond> ifCond1;
+            ASSERT_EQUALS("\n#line 4 \"forced.h\"\nint a ;\n#line 2 \"1.c\"\nint x = 1 + ( 1 + 1 ) ;",
+                          preprocessWithMacroState(code, "1.c", dui, macroStateCache, macroUsage1, ifCond1));
+            ASSERT_EQUALS(1, macroStateCache.size());
+            ASSERT_EQUALS(0, macroStateCache.hits());
+
+            // the second file starts from the macro state after forced.h
+            std::list<simplecpp::MacroUsage> macroUsage2;
+            std::list<simplecpp::IfCond> ifCond2;
+            ASSERT_EQUALS("\n#line 4 \"forced.h\"\nint a ;\n#line 2 \"2.c\"\nint x = 1 + ( 1 + 1 ) ;",
+                          preprocessWithMacroState(code, "2.c", dui, macroStateCache, macroUsage2, ifCond2));
+            ASSERT_EQUALS(1, macroStateCache.size());
+            ASSERT_EQUALS(1, macroStateCache.hits());
+            ASSERT_EQUALS(macroUsage1.size(), macroUsage2.size());
+            ASSERT_EQUALS(2, ifCond2.size());
+
+            // other settings
+            dui.defines.emplace_back("C=1");
+            std::list<simplecpp::MacroUsage> macroUsage3;
+            std::list<simplecpp::IfCond> ifCond3;
+            preprocessWithMacroState(code, "3.c", dui, macroStateCache, macroUsage3, ifCond3);
+            ASSERT_EQUALS(2, macroStateCache.size());
+            ASSERT_EQUALS(1, macroStateCache.hits());
+        }
+
+        // the snapshot is not used when forced.h has been changed
+        ScopedFile forced("forced.h",
+                          "#define A 2\n"
+                          "#define B(x) (x)\n");
+        std::list<simplecpp::MacroUsage> macroUsage;
+        std::list<simplecpp::IfCond> ifCond;
+        ASSERT_EQUALS("\nint x = 2 + ( 1 ) ;",
+                      preprocessWithMacroState(code, "3.c", dui, macroStateCache, macroUsage, ifCond));
+        ASSERT_EQUALS(1, macroStateCache.hits());
+    }
+
+    static std::string dumpTokens(const simplecpp::TokenList &tokens, const simplecpp::OutputList &outputList)
+    {
+        std::ostringstream ostr;
+        for (const simplecpp::Token *tok = tokens.cfront(); tok; tok = tok->next)
+            ostr << tok->location.line << ':' << tok->location.col << (tok->whitespaceahead ? " " : "") << ' ' << tok->str() << '\n';
+        for (const simplecpp::Output &output : outputList)
+            ostr << output.location.line << ':' << output.location.col << ' ' << output.msg << '\n';
+        return ostr.str();
+    }
+
+    // buffers and files are scanned in bulk, the result must be the same as when the code is read character by character
+    void bulkLexer()
+    {
+        const std::string code[] = {
+            "int a;  \t int b = 1'000'000 + 0x1fULL;\n",
+            "// comment \\\n   continued\nint a; // comment\\ \n b\n",
+            "/* comment\n * more */ int a; /**/ /***/ /*/ */ /* a *\\\n/ b */\n",
+            "const char *s = \"a\\\"b\\\\\"; char c = '\\''; const char *t = \"x\\\ny\";\n",
+            "#include <a\\\nb.h>\n#error don't\n#define X \"a b\"\n",
+            "auto s = R\"x(raw \" string\n)x\" u8R\"(r)\";\n",
+            "int a;\r\n// c\r\n/* x\r\n */ const char *s = \"a\";\r\nint b;",
+            "int a;\r// c\r/* x\r */ const char *s = \"a\";\rint b;",
+            "\xEF\xBB\xBFint a;\n",
+            std::string("int\0a;\x01 b\t;", 13),
+            "const char *s = \"unterminated\n",
+            "/* unterminated comment",
+            "// comment at end of file",
+            "abc"
+        };
+        for (const std::string &c : code) {
+            std::vector<std::string> files1;
+            std::istringstream istr(c);
+            simplecpp::OutputList outputList1;
+            const simplecpp::TokenList tokens1(istr, files1, "test.c", &outputList1);
+            const std::string expected = dumpTokens(tokens1, outputList1);
+
+            std::vector<std::string> files2;
+            simplecpp::OutputList outputList2;
+            const simplecpp::TokenList tokens2(simplecpp::View(c), files2, "test.c", &outputList2);
+            ASSERT_EQUALS(expected, dumpTokens(tokens2, outputList2));
+
+            {
+                std::ofstream fout("bulk.c", std::ios::binary);
+                fout << c;
+            }
+            std::vector<std::string> files3;
+            simplecpp::OutputList outputList3;
+            const simplecpp::TokenList tokens3("bulk.c", files3, &outputList3);
+            ASSERT_EQUALS(expected, dumpTokens(tokens3, outputList3));
+            std::remove("bulk.c");
+        }
+    }
 };
 
 REGISTER_TEST(TestPreprocessor)
@@ -24,6 +24,7 @@
 #include "utils.h"
 #include "vfvalue.h"
 
+#include <iterator>
 #include <stdexcept>
 
 class TestProgramMemory : public TestFixture {
@@ -36,6 +37,7 @@ private:
         TEST_CASE(hasValue);
         TEST_CASE(getValue);
         TEST_CASE(at);
+        TEST_CASE(manyValues);
     }
 
     void copyOnWrite() const {
@@ -101,6 +103,43 @@ private:
         ASSERT_THROW_EQUALS_2(pm.at(123), std::out_of_range, "ProgramMemory::at");
         ASSERT_THROW_EQUALS_2(utils::as_const(pm).at(123), std::out_of_range, "ProgramMemory::at");
     }
+
+    void manyValues() const {
+        SimpleTokenList tokenlist("a b c d e f ;");
+        // ids with the same low bits
+        const nonneg int ids[] = { 1, 33, 1025, 1 + (1 << 25), 2, 34 };
+        ProgramMemory pm;
+        int i = 0;
+        for (Token* tok = tokenlist.front(); tok && i < 6; tok = tok->next(), ++i) {
+            tok->exprId(ids[i]);
+            pm.setValue(tok, ValueFlow::Value{i});
+        }
+        ASSERT_EQUALS(6, pm.size());
+        for (i = 0; i < 6; ++i) {
+            const ValueFlow::Value* v = pm.getValue(ids[i]);
+            ASSERT(v);
+            ASSERT_EQUALS(i, v->intvalue);
+        }
+        ASSERT(!pm.hasValue(65));
+        ASSERT_EQUALS(6, std::distance(pm.begin(), pm.end()));
+
+        ProgramMemory pm2 = pm;
+        pm2.erase_if([](const ExprIdToken& e) {
+            return e.getExpressionId() % 32 == 1;
+        });
+        pm2.at(34).intvalue = 10;
+        ASSERT_EQUALS(2, pm2.size());
+        ASSERT_EQUALS(2, std::distance(pm2.begin(), pm2.end()));
+        ASSERT(!pm2.hasValue(1025));
+        ASSERT_EQUALS(10, pm2.at(34).intvalue);
+        ASSERT_EQUALS(6, pm.size());
+        ASSERT(pm.hasValue(1025));
+        ASSERT_EQUALS(5, pm.at(34).intvalue);
+
+        pm2.replace(pm);
+        ASSERT_EQUALS(6, pm2.size());
+        ASSERT_EQUALS(5, pm2.at(34).intvalue);
+    }
 };
 
 REGISTER_TEST(TestProgramMemory)
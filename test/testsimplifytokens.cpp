@@ -77,6 +77,7 @@ private:
         TEST_CASE(simplifyOperator2);
 
         TEST_CASE(simplifyArrayAccessSyntax);
+        TEST_CASE(simplifyPeepholes);
 
         TEST_CASE(pointeralias1);
         TEST_CASE(pointeralias3);
@@ -836,6 +837,18 @@ private:
                       "1: int a@1 ; a@1 [ 13 ] ;\n", tokenizeDebugListing("int a; 13[a];"));
     }
 
+    void simplifyPeepholes() {
+        // the handlers run in a single sweep over the token list
+        const char code[] = "void f(void) {\n"
+                            "    int a[2];\n"
+                            "    x = 1 - -2 + - -3;;\n"
+                            "    1[a] = g(void);\n"
+                            "    for (;;) { ; }\n"
+                            "    ; { ; }\n"
+                            "}";
+        ASSERT_EQUALS("void f ( ) { int a [ 2 ] ; x = 1 + 2 + 3 ; a [ 1 ] = g ( ) ; for ( ; ; ) { ; } ; }", tok(code));
+    }
+
 
     void pointeralias1() {
         {
@@ -133,6 +133,7 @@ private:
         TEST_CASE(many_threads);
         TEST_CASE(many_threads_showtime);
         TEST_CASE(many_threads_plist);
+        TEST_CASE(many_configs);
         TEST_CASE(no_errors_more_files);
         TEST_CASE(no_errors_less_files);
         TEST_CASE(no_errors_equal_amount_files);
@@ -198,6 +199,23 @@ private:
         ignore_errout();
     }
 
+    void many_configs() {
+        std::ostringstream oss;
+        const int num_cfgs = 8;
+        for (int i = 0; i < num_cfgs; i++) {
+            oss << "#ifdef CFG" << i << "\n"
+                << "void f" << i << "() { (void)(*((int*)0)); }\n"
+                << "#endif\n";
+        }
+        // the configurations are simplified by the threads without files
+        check(4, 1, 1, oss.str());
+        std::string expected;
+        for (int i = 0; i < num_cfgs; i++)
+            expected += "[" + fprefix() + "_1.c:" + std::to_string(3 * i + 2) + ":22]: (error) Null pointer dereference: (int*)0 [nullPointer]\n";
+        // the errors are reported in the order of the configurations
+        ASSERT_EQUALS(expected, errout_str());
+    }
+
     void no_errors_more_files() {
         check(2, 3, 0,
               "int main()\n"
@@ -73,6 +73,8 @@ private:
 
         TEST_CASE(deleteLast);
         TEST_CASE(deleteFirst);
+        TEST_CASE(tokenArena);
+        TEST_CASE(strId);
         TEST_CASE(nextArgument);
         TEST_CASE(eraseTokens);
 
@@ -89,6 +91,8 @@ private:
         TEST_CASE(matchOr);
         TEST_CASE(matchOp);
         TEST_CASE(matchConstOp);
+        TEST_CASE(matchCompiled);
+        TEST_CASE(matchCached);
 
         TEST_CASE(isArithmeticalOp);
         TEST_CASE(isOp);
@@ -120,6 +124,7 @@ private:
         TEST_CASE(expressionString);
 
         TEST_CASE(hasKnownIntValue);
+        TEST_CASE(sharedValues);
 
         TEST_CASE(update_property_info);
         TEST_CASE(update_property_info_evariable);
@@ -584,6 +589,49 @@ private:
         ASSERT_EQUALS(true, *tokensFront == &tok);
     }
 
+    void tokenArena() const {
+        auto tokensFrontBack = std::make_shared<TokensFrontBack>();
+        const TokenArena &arena = tokensFrontBack->arena;
+        Token tok(list, tokensFrontBack);
+        tok.str("x");
+        (void)tok.insertToken("a");
+        const Token * const a = tok.next();
+        ASSERT_EQUALS(1, arena.chunks());
+
+        // a deleted token is reused by the next insertion
+        tok.deleteNext();
+        (void)tok.insertToken("b");
+        ASSERT_EQUALS(true, a == tok.next());
+        ASSERT_EQUALS("b", tok.strAt(1));
+        ASSERT_EQUALS(1, arena.chunks());
+        tok.deleteNext();
+    }
+
+    void strId() const {
+        SimpleTokenList tokenlist("int x = x + if_x; if (x) {}");
+        Token *tok = tokenlist.front();
+        const Token *x1 = tok->next();
+        const Token *x2 = x1->tokAt(2);
+        Token *ifx = tok->tokAt(5);
+        ASSERT_EQUALS(true, x1->strId() == x2->strId());
+        ASSERT_EQUALS(true, Token::sameStr(x1, x2));
+        ASSERT_EQUALS(false, x1->strId() == ifx->strId());
+        ASSERT_EQUALS(false, Token::sameStr(x1, ifx));
+
+        const Token *ifTok = Token::findsimplematch(tok, "if (");
+        ASSERT(ifTok);
+        ASSERT_EQUALS(true, ifTok->isKeyword());
+        ASSERT_EQUALS(true, ifTok->isControlFlowKeyword());
+        ASSERT_EQUALS(true, tok->isStandardType());
+        ASSERT_EQUALS(false, ifx->isKeyword());
+
+        // strId is updated when the string is changed
+        ifx->str("x");
+        ASSERT_EQUALS(true, Token::sameStr(x1, ifx));
+        ifx->str("if_x");
+        ASSERT_EQUALS(false, Token::sameStr(x1, ifx));
+    }
+
     void nextArgument() {
         SimpleTokenizer example1(*this);
         ASSERT(example1.tokenize("foo(1, 2, 3, 4);"));
@@ -859,6 +907,85 @@ private:
     }
 
 
+#define matchCompiledCheck(...) matchCompiledCheck_(__FILE__, __LINE__, __VA_ARGS__)
+    template<size_t count>
+    void matchCompiledCheck_(const char* file, int line, const Token* start, const char (&pattern)[count], nonneg int varid = 0) const {
+        const std::string parsed(pattern);
+        for (const Token* tok = start; tok; tok = tok->next())
+            assertEquals(file, line, Token::Match(tok, parsed.c_str(), varid), Token::Match(tok, pattern, varid), pattern);
+        assertEquals(file, line, Token::Match(nullptr, parsed.c_str(), varid), Token::Match(nullptr, pattern, varid), pattern);
+    }
+
+    void matchCompiled() {
+        SimpleTokenizer tokenizer(*this);
+        ASSERT(tokenizer.tokenize("int f(int x, const char *s) {\n"
+                                  "    if (x == 1 || x != 'a' && !s[0]) { x |= 2; return x | 3; }\n"
+                                  "    else x = true ? 4.5 : \"abc\";\n"
+                                  "    return x [ 1 ];\n"
+                                  "}"));
+        const Token* start = tokenizer.tokens();
+        const int varid = Token::findsimplematch(start, "x")->varId();
+
+        matchCompiledCheck(start, "");
+        matchCompiledCheck(start, "  ");
+        matchCompiledCheck(start, "if (");
+        matchCompiledCheck(start, "if|else|return %name%|%num%");
+        matchCompiledCheck(start, "%var% %assign%|%comp%|%or%|%oror% %any%");
+        matchCompiledCheck(start, "%type% %name% (|,");
+        matchCompiledCheck(start, "%op%|%cop% %bool%|%char%|%str%");
+        matchCompiledCheck(start, "[(,] const| %type% *| %name%");
+        matchCompiledCheck(start, "[;{}] !!else");
+        matchCompiledCheck(start, "!! ;");
+        matchCompiledCheck(start, "x !!");
+        matchCompiledCheck(start, "%name% [ [[]] %num% []]");
+        matchCompiledCheck(start, "|x|| =|");
+        matchCompiledCheck(start, "%varid% %op%", varid);
+        matchCompiledCheck(start, "return %varid%|%num% ;|", varid);
+
+        ASSERT_THROW_INTERNAL(Token::Match(start, "%type% %varid%"), INTERNAL);
+        ASSERT_THROW_INTERNAL(Token::Match(start, "%type% %foo%"), INTERNAL);
+    }
+#undef matchCompiledCheck
+
+    void matchCached() {
+        SimpleTokenizer tokenizer(*this);
+        ASSERT(tokenizer.tokenize("void f(int x) { std :: vector < int > v ; x = v . size ( ) ; }"));
+        const Token* start = tokenizer.tokens();
+        const Token* stdTok = Token::findsimplematch(start, "std");
+        const Token* x = Token::findsimplematch(start, "x =");
+
+        std::string pattern = "std :: vector <";
+        ASSERT_EQUALS(true, Token::Match(stdTok, pattern));
+        ASSERT_EQUALS(false, Token::Match(x, pattern));
+        ASSERT_EQUALS(false, Token::Match(nullptr, pattern));
+
+        // the same string object with another pattern
+        pattern[0] = 'x';
+        pattern[1] = ' ';
+        pattern[2] = '=';
+        ASSERT_EQUALS("x = :: vector <", pattern);
+        ASSERT_EQUALS(false, Token::Match(stdTok, pattern));
+        pattern.assign("x = v");
+        ASSERT_EQUALS(true, Token::Match(x, pattern));
+        pattern.assign("x = %name% . size|empty (");
+        ASSERT_EQUALS(true, Token::Match(x, pattern));
+        pattern.assign("x !!=");
+        ASSERT_EQUALS(false, Token::Match(x, pattern));
+        pattern.assign("!!");
+        ASSERT_EQUALS(false, Token::Match(x, pattern));
+        pattern.assign("!! =");
+        ASSERT_EQUALS(true, Token::Match(x, pattern));
+        pattern.assign("%varid% =");
+        ASSERT_EQUALS(true, Token::Match(x, pattern, x->varId()));
+        ASSERT_THROW_INTERNAL(Token::Match(x, pattern), INTERNAL);
+        pattern.assign("%name% %foo%");
+        ASSERT_THROW_INTERNAL(Token::Match(x, pattern), INTERNAL);
+
+        ASSERT_EQUALS(x, Token::findmatch(start, "%varid% = %var%", x->varId()));
+        ASSERT_EQUALS(x->tokAt(2), Token::findmatch(start, "%var% . size|empty ("));
+        ASSERT(nullptr == Token::findmatch(start, "%var% . size|empty (", x->tokAt(2)));
+    }
+
     void isArithmeticalOp() const {
         for (auto test_op = arithmeticalOps.cbegin(); test_op != arithmeticalOps.cend(); ++test_op) {
             auto tokensFrontBack = std::make_shared<TokensFrontBack>();
@@ -1255,6 +1382,32 @@ private:
         ASSERT_EQUALS(false, token.hasKnownIntValue());
     }
 
+    void sharedValues() const {
+        ValueFlow::Value v1(1);
+        v1.setKnown();
+
+        auto tokensFrontBack = std::make_shared<TokensFrontBack>();
+        Token tok1(list, tokensFrontBack);
+        Token tok2(list, tokensFrontBack);
+        ASSERT_EQUALS(true, tok1.addValue(v1));
+        ASSERT_EQUALS(true, tok2.addValue(v1));
+        ASSERT_EQUALS(true, &tok1.values() == &tok2.values());
+        ASSERT_EQUALS(1, tokensFrontBack->values.size());
+
+        // copy on write
+        ValueFlow::Value v2(2);
+        v2.valueType = ValueFlow::Value::ValueType::BUFFER_SIZE;
+        ASSERT_EQUALS(true, tok2.addValue(v2));
+        ASSERT_EQUALS(1, tok1.values().size());
+        ASSERT_EQUALS(2, tok2.values().size());
+
+        tok2.removeValues(std::mem_fn(&ValueFlow::Value::isBufferSizeValue));
+        ASSERT_EQUALS(true, &tok1.values() == &tok2.values());
+        tok1.removeValues(std::mem_fn(&ValueFlow::Value::isKnown));
+        ASSERT_EQUALS(0, tok1.values().size());
+        ASSERT_EQUALS(1, tok2.values().size());
+    }
+
 #define assert_tok(...) _assert_tok(__FILE__, __LINE__, __VA_ARGS__)
     void _assert_tok(const char* file, int line, const Token* tok, Token::Type t, bool l = false, bool std = false, bool ctrl = false) const
     {
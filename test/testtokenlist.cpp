@@ -46,6 +46,7 @@ private:
         TEST_CASE(isKeyword);
         TEST_CASE(notokens);
         TEST_CASE(ast1);
+        TEST_CASE(tokenIndex);
     }
 
     // inspired by #5895
@@ -187,6 +188,58 @@ private:
         }
         tokenlist.createAst(); // do not crash
     }
+
+    void tokenIndex() {
+        TokenList tokenlist(settingsDefault, Standards::Language::CPP);
+        ASSERT(tokenlist.createTokensFromString("int a [ 10 ] = { 1 , 2 , 3 } ;"));
+        ASSERT(tokenlist.tokenIndex().empty());
+        ASSERT(tokenlist.tokenAt(1) == nullptr);
+
+        tokenlist.createTokenIndex();
+        ASSERT_EQUALS(14, tokenlist.tokenIndex().size());
+        ASSERT(tokenlist.front() == tokenlist.tokenAt(1));
+        ASSERT(tokenlist.back() == tokenlist.tokenAt(14));
+        ASSERT(tokenlist.tokenAt(0) == nullptr);
+        ASSERT(tokenlist.tokenAt(15) == nullptr);
+        for (const Token *tok = tokenlist.front(); tok; tok = tok->next())
+            ASSERT(tok == tokenlist.tokenAt(tok->index()));
+
+        Token *eq = Token::findsimplematch(tokenlist.front(), "=");
+        ASSERT_EQUALS("10", eq->strAt(-2));
+        ASSERT_EQUALS("int", eq->strAt(-5));
+        ASSERT_EQUALS("3", eq->strAt(6));
+        ASSERT(eq->tokAt(-6) == nullptr);
+        ASSERT(eq->tokAt(9) == nullptr);
+
+        // the index is dropped when the list is changed
+        eq->insertToken("x");
+        ASSERT(tokenlist.tokenIndex().empty());
+        ASSERT_EQUALS("2", eq->strAt(5));
+        ASSERT_EQUALS("10", eq->strAt(-2));
+
+        tokenlist.createTokenIndex();
+        ASSERT_EQUALS(15, tokenlist.tokenIndex().size());
+        ASSERT_EQUALS("2", eq->strAt(5));
+        eq->next()->swapWithNext();
+        ASSERT(tokenlist.tokenIndex().empty());
+        ASSERT_EQUALS("x", eq->strAt(2));
+
+        tokenlist.createTokenIndex();
+        eq->deleteNext();
+        ASSERT(tokenlist.tokenIndex().empty());
+        ASSERT_EQUALS("1", eq->strAt(2));
+
+        // the tokenizer creates the index when it is done with simplifying the token list
+        SimpleTokenizer tokenizer(settingsDefault, *this);
+        ASSERT(tokenizer.tokenize("void f(int x) { if (x > 0) { x = 0; } }"));
+        const std::vector<Token*>& tokens = tokenizer.list.tokenIndex();
+        ASSERT(!tokens.empty());
+        ASSERT(tokens.front() == tokenizer.tokens());
+        ASSERT(tokens.back() == tokenizer.list.back());
+        const Token *tok = tokenizer.tokens();
+        for (std::size_t i = 0; i < tokens.size(); ++i, tok = tok->next())
+            ASSERT(tokens[i] == tok);
+    }
 };
 
 REGISTER_TEST(TestTokenList)
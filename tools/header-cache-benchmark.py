@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+
+# Measure the time that is spent to read the headers of each file with and without --header-cache
+# The synthetic project consists of many source files that all include the same set of large headers.
+# Example usage:
+# cd ~/cppcheck && make CXXOPTS=-O2 MATCHCOMPILER=yes
+# python3 tools/header-cache-benchmark.py --cppcheck-path=~/cppcheck/cppcheck -j 4
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def create_project(path, headers, declarations, sources):
+    for h in range(headers):
+        with open(os.path.join(path, 'header{}.h'.format(h)), 'wt') as f:
+            f.write('#ifndef HEADER{}_H\n#define HEADER{}_H\n'.format(h, h))
+            for d in range(declarations):
+                f.write('struct S{}_{} {{ int a; long b; const char *c; }};\n'.format(h, d))
+                f.write('int f{}_{}(struct S{}_{} *s, int x); /* comment */\n'.format(h, d, h, d))
+            f.write('#endif\n')
+    for s in range(sources):
+        with open(os.path.join(path, 'file{}.c'.format(s)), 'wt') as f:
+            for h in range(headers):
+                f.write('#include "header{}.h"\n'.format(h))
+            f.write('int g{}(void) {{ return 0; }}\n'.format(s))
+
+
+def run(cppcheck, path, jobs, cache_size):
+    args = [cppcheck, '-q', '-j{}'.format(jobs), '--executor=thread', '--showtime=summary', '--check-level=normal',
+            '--header-cache={}'.format(cache_size), path]
+    start = time.time()
+    p = subprocess.run(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True, check=False)
+    elapsed = time.time() - start
+    if p.returncode != 0:
+        print(p.stderr)
+        sys.exit(1)
+    res = re.search(r'^Preprocessor::loadFiles: ([0-9.e-]+)s \(avg\. ([0-9.e-]+)s - ([0-9]+) result\(s\)\)$', p.stdout, re.MULTILINE)
+    if res is None:
+        print('No Preprocessor::loadFiles timing found')
+        sys.exit(1)
+    return elapsed, float(res.group(2))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='Compare the time to read the headers with and without --header-cache')
+    parser.add_argument('--cppcheck-path', required=True, type=str, help='Path to Cppcheck binary')
+    parser.add_argument('-j', default=1, type=int, help='Concurrent execution threads')
+    parser.add_argument('--headers', default=20, type=int, help='Count of headers included by each file')
+    parser.add_argument('--declarations', default=500, type=int, help='Count of declarations in each header')
+    parser.add_argument('--sources', default=100, type=int, help='Count of source files')
+    parser.add_argument('--cache-size', default=256, type=int, help='Memory limit of the header cache in MiB')
+    args = parser.parse_args()
+
+    cppcheck_path = os.path.expanduser(args.cppcheck_path)
+    with tempfile.TemporaryDirectory() as project_path:
+        create_project(project_path, args.headers, args.declarations, args.sources)
+        print('{} files including {} headers with {} declarations each'.format(args.sources, args.headers, args.declarations))
+        for cache_size in (0, args.cache_size):
+            elapsed, per_file = run(cppcheck_path, project_path, args.j, cache_size)
+            print('--header-cache={}: total {:.2f}s, Preprocessor::loadFiles {:.2f}ms per file'.format(cache_size, elapsed, per_file * 1000))
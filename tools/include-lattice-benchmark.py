@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+
+# Measure the time that is spent to preprocess files with a deep include lattice
+# Every header includes all headers of the next layer so most of the includes are repeated includes of
+# headers which are protected by an include guard.
+# Example usage (compare two builds):
+# python3 tools/include-lattice-benchmark.py --cppcheck-path=~/cppcheck-old/cppcheck --cppcheck-path=~/cppcheck/cppcheck
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def create_project(path, layers, width, sources):
+    for layer in range(layers):
+        for w in range(width):
+            with open(os.path.join(path, 'h{}_{}.h'.format(layer, w)), 'wt') as f:
+                f.write('/* header {} of layer {} */\n'.format(w, layer))
+                f.write('#ifndef H{}_{}_H\n#define H{}_{}_H\n'.format(layer, w, layer, w))
+                if layer + 1 < layers:
+                    for w2 in range(width):
+                        f.write('#include "h{}_{}.h"\n'.format(layer + 1, w2))
+                f.write('#ifdef FEATURE\nint feature{}_{};\n#endif\n'.format(layer, w))
+                f.write('int v{}_{}(int a);\n'.format(layer, w))
+                f.write('#endif /* H{}_{}_H */\n'.format(layer, w))
+    for s in range(sources):
+        with open(os.path.join(path, 'file{}.c'.format(s)), 'wt') as f:
+            for w in range(width):
+                f.write('#include "h0_{}.h"\n'.format(w))
+            f.write('int g{}(void) {{ return 0; }}\n'.format(s))
+
+
+def run(cppcheck, path):
+    args = [cppcheck, '-q', '--showtime=summary', '--check-level=normal', path]
+    start = time.time()
+    p = subprocess.run(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True, check=False)
+    elapsed = time.time() - start
+    if p.returncode != 0:
+        print(p.stderr)
+        sys.exit(1)
+    res = re.search(r'^Tokenizer::createTokens: ([0-9.e-]+)s \(avg\. ([0-9.e-]+)s - ([0-9]+) result\(s\)\)$', p.stdout, re.MULTILINE)
+    if res is None:
+        print('No Tokenizer::createTokens timing found')
+        sys.exit(1)
+    return elapsed, float(res.group(2))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='Measure the time to preprocess files with a deep include lattice')
+    parser.add_argument('--cppcheck-path', required=True, action='append', type=str, help='Path to Cppcheck binary (can be given multiple times)')
+    parser.add_argument('--layers', default=6, type=int, help='Count of header layers')
+    parser.add_argument('--width', default=30, type=int, help='Count of headers in each layer')
+    parser.add_argument('--sources', default=10, type=int, help='Count of source files')
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as project_path:
+        create_project(project_path, args.layers, args.width, args.sources)
+        print('{} files including {} layers of {} headers'.format(args.sources, args.layers, args.width))
+        for cppcheck_path in args.cppcheck_path:
+            elapsed, per_config = run(os.path.expanduser(cppcheck_path), project_path)
+            print('{}: total {:.2f}s, Tokenizer::createTokens {:.2f}ms per configuration'.format(cppcheck_path, elapsed, per_config * 1000))
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+
+# Measure the time that is spent to simplify templates in a file with many templates
+# Every class template and function template is instantiated with several types and the
+# class templates are also used as template arguments of other class templates.
+# Example usage (compare two builds):
+# python3 tools/template-stress-benchmark.py --cppcheck-path=~/cppcheck-old/cppcheck --cppcheck-path=~/cppcheck/cppcheck
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+
+TYPES = ['int', 'long', 'char', 'double', 'unsigned int']
+
+
+def create_code(templates, namespaces):
+    code = ''
+    for t in range(templates):
+        code += 'namespace ns{} {{\n'.format(t % namespaces)
+        code += 'template<class T> struct A{} {{ T x; T get() const {{ return x; }} }};\n'.format(t)
+        code += 'template<class T, class U> struct B{} {{ T x; U y; }};\n'.format(t)
+        code += 'template<class T> T f{}(T a) {{ return a; }}\n'.format(t)
+        code += '}\n'
+    for t in range(templates):
+        ns = 'ns{}'.format(t % namespaces)
+        other = 'ns{}::A{}'.format((t + 1) % templates % namespaces, (t + 1) % templates)
+        code += 'void use{}() {{\n'.format(t)
+        for type in TYPES:
+            code += '    {}::A{}<{}> a_{};\n'.format(ns, t, type, type.replace(' ', '_'))
+            code += '    {}::f{}<{}>(0);\n'.format(ns, t, type)
+        code += '    {}::B{}<{}<int>, {}<long>> b;\n'.format(ns, t, other, other)
+        code += '}\n'
+    return code
+
+
+def run(cppcheck, filename):
+    args = [cppcheck, '-q', '--showtime=summary', '--check-level=normal', filename]
+    start = time.time()
+    p = subprocess.run(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True, check=False)
+    elapsed = time.time() - start
+    if p.returncode != 0:
+        print(p.stderr)
+        sys.exit(1)
+    res = re.search(r'^Tokenizer::simplifyTokens1::simplifyTokenList1::simplifyTemplates: ([0-9.e-]+)s', p.stdout, re.MULTILINE)
+    if res is None:
+        print('No simplifyTemplates timing found')
+        sys.exit(1)
+    return elapsed, float(res.group(1))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='Measure the time to simplify many templates')
+    parser.add_argument('--cppcheck-path', required=True, action='append', type=str, help='Path to Cppcheck binary (can be given multiple times)')
+    parser.add_argument('--templates', default=300, type=int, help='Count of each kind of template')
+    parser.add_argument('--namespaces', default=10, type=int, help='Count of namespaces the templates are spread over')
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as project_path:
+        filename = os.path.join(project_path, 'templates.cpp')
+        with open(filename, 'wt') as f:
+            f.write(create_code(args.templates, args.namespaces))
+        print('{} class templates, {} function templates in {} namespaces'.format(2 * args.templates, args.templates, args.namespaces))
+        for cppcheck_path in args.cppcheck_path:
+            elapsed, simplify = run(os.path.expanduser(cppcheck_path), filename)
+            print('{}: total {:.2f}s, simplifyTemplates {:.2f}s'.format(cppcheck_path, elapsed, simplify))